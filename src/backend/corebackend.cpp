@@ -18,7 +18,12 @@
 #include "backend/corebackend.h"
 
 #include "core/device.h"
+#include "core/devicefilter.h"
+#include "core/partition.h"
 #include "core/partitiontable.h"
+#include "core/volumemanagerdevice.h"
+
+#include "fs/lvm2_pv.h"
 
 #include "util/globallog.h"
 
@@ -38,6 +43,64 @@ CoreBackend::~CoreBackend()
 {
 }
 
+/** Checks if a Device holds a partition used by one of the given volume manager devices */
+static bool holdsMember(const Device* d, const QList<Device*>& volumeManagers)
+{
+    if (d->partitionTable() == nullptr)
+        return false;
+
+    for (const Device* vm : volumeManagers) {
+        const QStringList members = static_cast<const VolumeManagerDevice*>(vm)->deviceNodes();
+        for (const Partition* p : d->partitionTable()->children()) {
+            if (members.contains(p->partitionPath()))
+                return true;
+            for (const Partition* child : p->children())
+                if (members.contains(child->partitionPath()))
+                    return true;
+        }
+    }
+
+    return false;
+}
+
+/** Fallback for backends without targeted scanning: runs a full scan and drops
+    the devices the filter does not select, keeping those that hold members of
+    selected volume manager devices.
+*/
+QList<Device*> CoreBackend::scanDevices(const DeviceFilter& filter, const ScanFlags scanFlags)
+{
+    QList<Device*> devices = scanDevices(scanFlags);
+    if (filter.matchesAll())
+        return devices;
+
+    QList<Device*> selected;
+    QList<Device*> volumeManagers;
+    for (Device* d : qAsConst(devices)) {
+        if (filter.matches(d->deviceNode(), d->type())) {
+            selected.append(d);
+            if (d->type() == Device::Type::LVM_Device || d->type() == Device::Type::SoftwareRAID_Device)
+                volumeManagers.append(d);
+        }
+    }
+
+    QList<Device*> result;
+    for (Device* d : qAsConst(devices)) {
+        if (selected.contains(d) || holdsMember(d, volumeManagers))
+            result.append(d);
+        else
+            delete d;
+    }
+
+    // The list of physical volumes referred to partitions of the deleted devices
+    LVM::pvList::list().clear();
+    LVM::pvList::list().append(FS::lvm2_pv::getPVs(result));
+    for (const Device* d : qAsConst(result))
+        if (d->type() == Device::Type::LVM_Device)
+            LVM::pvList::list().append(FS::lvm2_pv::getPVinNode(d->partitionTable()));
+
+    return result;
+}
+
 void CoreBackend::emitProgress(int i)
 {
     emit progress(i);
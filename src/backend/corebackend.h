@@ -32,6 +32,7 @@ class CoreBackendManager;
 class CoreBackendDevice;
 struct CoreBackendPrivate;
 class Device;
+class DeviceFilter;
 class PartitionTable;
 
 class QString;
@@ -39,6 +40,9 @@ class QString;
 enum class ScanFlag : uint8_t {
     includeReadOnly = 0x1, /**< devices that are read-only according to the kernel */
     includeLoopback = 0x2,
+    forceFullRescan = 0x4, /**< ignore snapshots of previous scans kept by the backend */
+    layoutOnly = 0x8, /**< only read partition tables and file system types; labels, UUIDs and usage are loaded on first access */
+    identityOnly = 0x10, /**< also read labels and UUIDs; usage of unmounted file systems is loaded on first access */
 };
 Q_DECLARE_FLAGS(ScanFlags, ScanFlag)
 Q_DECLARE_OPERATORS_FOR_FLAGS(ScanFlags)
@@ -113,6 +117,17 @@ public:
       */
     virtual QList<Device*> scanDevices(const ScanFlags scanFlags) = 0;
 
+    /**
+      * Scan only some of the devices in the system.
+      * @param filter selects devices by device node pattern, type and exclusion list.
+      *         Disks holding members of selected volume manager devices are
+      *         scanned and returned as well.
+      * @param scanFlags can be used to expand the list of scanned devices.
+      * @return a QList of pointers to Device instances. The caller is responsible
+      *         for deleting these objects.
+      */
+    virtual QList<Device*> scanDevices(const DeviceFilter& filter, const ScanFlags scanFlags);
+
     /**
       * Scan a single device in the system.
       * @param deviceNode The path to the device that is to be scanned (e.g. /dev/sda1)
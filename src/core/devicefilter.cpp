@@ -0,0 +1,62 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#include "core/devicefilter.h"
+
+#include <QRegExp>
+
+static bool matchesAny(const QStringList& patterns, const QString& deviceNode)
+{
+    for (const QString& pattern : patterns)
+        if (QRegExp(pattern, Qt::CaseSensitive, QRegExp::WildcardUnix).exactMatch(deviceNode))
+            return true;
+
+    return false;
+}
+
+/** Creates a new DeviceFilter
+    @param deviceNodes device node patterns to include, empty for all
+    @param deviceTypes device types to include, empty for all
+    @param excludedDeviceNodes device node patterns to leave out even if they match
+*/
+DeviceFilter::DeviceFilter(const QStringList& deviceNodes, const QList<Device::Type>& deviceTypes, const QStringList& excludedDeviceNodes) :
+    m_DeviceNodes(deviceNodes),
+    m_DeviceTypes(deviceTypes),
+    m_ExcludedDeviceNodes(excludedDeviceNodes)
+{
+}
+
+/** @param deviceNode the device node (e.g. "/dev/sda")
+    @param type the type of the device
+    @return true if the device is selected by this filter
+*/
+bool DeviceFilter::matches(const QString& deviceNode, Device::Type type) const
+{
+    if (!m_DeviceTypes.isEmpty() && !m_DeviceTypes.contains(type))
+        return false;
+
+    if (!m_DeviceNodes.isEmpty() && !matchesAny(m_DeviceNodes, deviceNode))
+        return false;
+
+    return !matchesAny(m_ExcludedDeviceNodes, deviceNode);
+}
+
+/** @return true if this filter selects every device */
+bool DeviceFilter::matchesAll() const
+{
+    return m_DeviceNodes.isEmpty() && m_DeviceTypes.isEmpty() && m_ExcludedDeviceNodes.isEmpty();
+}
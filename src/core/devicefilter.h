@@ -0,0 +1,71 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#ifndef KPMCORE_DEVICEFILTER_H
+#define KPMCORE_DEVICEFILTER_H
+
+#include "core/device.h"
+#include "util/libpartitionmanagerexport.h"
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+/** Selects the devices a targeted scan probes.
+
+    Device node patterns use shell wildcards, e.g. "/dev/nvme*". Empty lists of
+    patterns or types match every device.
+
+    @see CoreBackend::scanDevices(const DeviceFilter&, const ScanFlags)
+*/
+class LIBKPMCORE_EXPORT DeviceFilter
+{
+public:
+    DeviceFilter() = default;
+    DeviceFilter(const QStringList& deviceNodes, const QList<Device::Type>& deviceTypes = {}, const QStringList& excludedDeviceNodes = {});
+
+public:
+    bool matches(const QString& deviceNode, Device::Type type) const;
+    bool matchesAll() const;
+
+    const QStringList& deviceNodes() const {
+        return m_DeviceNodes; /**< @return device node patterns to include */
+    }
+    const QList<Device::Type>& deviceTypes() const {
+        return m_DeviceTypes; /**< @return device types to include */
+    }
+    const QStringList& excludedDeviceNodes() const {
+        return m_ExcludedDeviceNodes; /**< @return device node patterns to exclude */
+    }
+
+    void setDeviceNodes(const QStringList& patterns) {
+        m_DeviceNodes = patterns;
+    }
+    void setDeviceTypes(const QList<Device::Type>& types) {
+        m_DeviceTypes = types;
+    }
+    void setExcludedDeviceNodes(const QStringList& patterns) {
+        m_ExcludedDeviceNodes = patterns;
+    }
+
+private:
+    QStringList m_DeviceNodes;
+    QList<Device::Type> m_DeviceTypes;
+    QStringList m_ExcludedDeviceNodes;
+};
+
+#endif
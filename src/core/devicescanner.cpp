@@ -23,12 +23,18 @@
 
 #include "core/operationstack.h"
 #include "core/device.h"
+#include "core/devicefilter.h"
 #include "core/diskdevice.h"
+#include "core/partition.h"
+#include "core/partitiontable.h"
+#include "core/ueventmonitor.h"
 
 #include "fs/lvm2_pv.h"
 
 #include "util/externalcommand.h"
 
+#include <QMutexLocker>
+#include <QReadLocker>
 #include <QRegularExpression>
 
 /** Constructs a DeviceScanner
@@ -36,9 +42,20 @@
 */
 DeviceScanner::DeviceScanner(QObject* parent, OperationStack& ostack) :
     QThread(parent),
-    m_OperationStack(ostack)
+    m_OperationStack(ostack),
+    m_Monitor(nullptr),
+    m_ScanFlags(ScanFlag::includeLoopback),
+    m_WarmDetails(false),
+    m_Incremental(false)
 {
     setupConnections();
+    connect(this, &QThread::finished, this, [this] {
+        QMutexLocker lock(&m_PendingMutex);
+        if (!m_PendingChanged.isEmpty() || !m_PendingRemoved.isEmpty()) {
+            m_Incremental = true;
+            start();
+        }
+    });
 }
 
 void DeviceScanner::setupConnections()
@@ -52,9 +69,146 @@ void DeviceScanner::clear()
     operationStack().clearDevices();
 }
 
+/** Starts or stops listening for udev block device events
+
+    While watching, added, changed and removed disks are rescanned individually
+    in the background instead of requiring a full scan().
+
+    @param watch true to start listening, false to stop
+    @return true if the requested state could be reached
+*/
+bool DeviceScanner::watchDevices(bool watch)
+{
+    if (!watch) {
+        if (m_Monitor)
+            m_Monitor->stop();
+        return true;
+    }
+
+    if (!m_Monitor) {
+        m_Monitor = new UeventMonitor(this);
+        connect(m_Monitor, &UeventMonitor::devicesChanged, this, &DeviceScanner::queueRescan);
+    }
+
+    return m_Monitor->start();
+}
+
+void DeviceScanner::queueRescan(const QStringList& changedDevices, const QStringList& removedDevices)
+{
+    QMutexLocker lock(&m_PendingMutex);
+
+    for (const auto &node : changedDevices) {
+        m_PendingRemoved.removeAll(node);
+        if (!m_PendingChanged.contains(node))
+            m_PendingChanged.append(node);
+    }
+    for (const auto &node : removedDevices) {
+        m_PendingChanged.removeAll(node);
+        if (!m_PendingRemoved.contains(node))
+            m_PendingRemoved.append(node);
+    }
+
+    // Events arriving during a scan are picked up once the scan has finished
+    if (!isRunning()) {
+        m_Incremental = true;
+        start();
+    }
+}
+
 void DeviceScanner::run()
 {
+    QStringList changed;
+    QStringList removed;
+    bool incremental;
+    {
+        QMutexLocker lock(&m_PendingMutex);
+        incremental = m_Incremental;
+        m_Incremental = false;
+        changed.swap(m_PendingChanged);
+        removed.swap(m_PendingRemoved);
+    }
+
+    if (incremental) {
+        rescan(changed, removed);
+        return;
+    }
+
     scan();
+
+    // Devices are already visible through OperationStack::devicesChanged() at this point
+    if (m_WarmDetails && (m_ScanFlags.testFlag(ScanFlag::layoutOnly) || m_ScanFlags.testFlag(ScanFlag::identityOnly))) {
+        loadDetails();
+        emit operationStack().devicesChanged();
+    }
+}
+
+/** Sets the flags used for scanning.
+
+    With ScanFlag::layoutOnly or ScanFlag::identityOnly the scan returns before file system
+    details are known. Those are loaded on first access or, if @p warmDetails is set, by the
+    scanner thread right after the quick scan has finished.
+
+    @param flags the flags passed to CoreBackend::scanDevices()
+    @param warmDetails true to load skipped details in the background
+*/
+void DeviceScanner::setScanFlags(ScanFlags flags, bool warmDetails)
+{
+    m_ScanFlags = flags;
+    m_WarmDetails = warmDetails;
+}
+
+void DeviceScanner::loadDetails()
+{
+    // Loading runs external tools, so only collect the file systems with the lock held
+    QList<FileSystem*> fileSystems;
+    {
+        QReadLocker lockDevices(&operationStack().lock());
+
+        for (const auto &d : qAsConst(operationStack().previewDevices())) {
+            if (d->partitionTable() == nullptr)
+                continue;
+
+            for (const auto &p : d->partitionTable()->children()) {
+                fileSystems.append(&p->fileSystem());
+                for (const auto &child : p->children())
+                    fileSystems.append(&child->fileSystem());
+            }
+        }
+    }
+
+    for (const auto &fs : qAsConst(fileSystems))
+        fs->loadDetails();
+}
+
+void DeviceScanner::rescan(const QStringList& changedDevices, const QStringList& removedDevices)
+{
+    for (const auto &node : removedDevices)
+        operationStack().removeDevice(node);
+
+    if (!changedDevices.isEmpty()) {
+        // Select the changed disks the same way a full scan does, so devices it skips
+        // (read-only or loop devices, optical drives, zram) do not show up after hot-plug
+        const DeviceFilter filter(changedDevices, { Device::Type::Disk_Device });
+        const QList<Device*> deviceList = CoreBackendManager::self()->backend()->scanDevices(filter, m_ScanFlags);
+
+        for (const auto &node : changedDevices) {
+            Device* found = nullptr;
+            for (const auto &d : deviceList)
+                if (d->deviceNode() == node)
+                    found = d;
+
+            if (found)
+                operationStack().updateDevice(found);
+            else
+                operationStack().removeDevice(node);
+        }
+
+        for (const auto &d : deviceList)
+            if (!changedDevices.contains(d->deviceNode()))
+                delete d;
+    }
+
+    operationStack().sortDevices();
 }
 
 void DeviceScanner::scan()
@@ -63,7 +217,7 @@ void DeviceScanner::scan()
 
     clear();
 
-    const QList<Device*> deviceList = CoreBackendManager::self()->backend()->scanDevices(ScanFlag::includeLoopback);
+    const QList<Device*> deviceList = CoreBackendManager::self()->backend()->scanDevices(m_ScanFlags);
 
     for (const auto &d : deviceList)
         operationStack().addDevice(d);
@@ -18,11 +18,15 @@
 #ifndef KPMCORE_DEVICESCANNER_H
 #define KPMCORE_DEVICESCANNER_H
 
+#include "backend/corebackend.h"
 #include "util/libpartitionmanagerexport.h"
 
+#include <QMutex>
+#include <QStringList>
 #include <QThread>
 
 class OperationStack;
+class UeventMonitor;
 
 /** Thread to scan for all available Devices on this computer.
 
@@ -40,13 +44,23 @@ public:
 public:
     void clear(); /**< clear Devices and the OperationStack */
     void scan(); /**< do the actual scanning; blocks if called directly */
+    void rescan(const QStringList& changedDevices, const QStringList& removedDevices = {}); /**< rescan only the given Devices; blocks */
     void setupConnections();
 
+    bool watchDevices(bool watch);
+
+    void setScanFlags(ScanFlags flags, bool warmDetails = false);
+    ScanFlags scanFlags() const {
+        return m_ScanFlags; /**< @return the flags passed to CoreBackend::scanDevices() */
+    }
+    void loadDetails(); /**< load all details skipped by a quick scan; blocks */
+
 Q_SIGNALS:
     void progress(const QString& deviceNode, int progress);
 
 protected:
     void run() override;
+    void queueRescan(const QStringList& changedDevices, const QStringList& removedDevices);
     OperationStack& operationStack() {
         return m_OperationStack;
     }
@@ -56,6 +70,13 @@ protected:
 
 private:
     OperationStack& m_OperationStack;
+    UeventMonitor* m_Monitor;
+    ScanFlags m_ScanFlags;
+    bool m_WarmDetails;
+    QMutex m_PendingMutex;
+    bool m_Incremental;
+    QStringList m_PendingChanged;
+    QStringList m_PendingRemoved;
 };
 
 #endif
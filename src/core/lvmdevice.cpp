@@ -17,6 +17,7 @@
  *************************************************************************/
 
 #include "core/lvmdevice.h"
+#include "core/lvmreport.h"
 #include "core/partition.h"
 #include "core/partitiontable.h"
 #include "core/volumemanagerdevice_p.h"
@@ -176,7 +177,7 @@ Partition* LvmDevice::scanPartition(const QString& lvPath, PartitionTable* pTabl
             if (logicalSize() > 0 && fs->type() != FileSystem::Type::Luks && mounted && storage.isValid())
                 fs->setSectorsUsed( (storage.bytesTotal() - storage.bytesFree()) / logicalSize() );
         }
-        else if (fs->supportGetUsed() == FileSystem::cmdSupportFileSystem)
+        else if (fs->supportGetUsed() != FileSystem::cmdSupportNone)
             fs->setSectorsUsed(qCeil(fs->readUsedCapacity(lvPath) / static_cast<double>(logicalSize())));
    }
 
@@ -204,11 +205,20 @@ Partition* LvmDevice::scanPartition(const QString& lvPath, PartitionTable* pTabl
  *  @param devices list of initialized Devices
  */
 void LvmDevice::scanSystemLVM(QList<Device*>& devices)
+{
+    scanSystemLVM(devices, getVGs());
+}
+
+/** Scans the given volume groups and appends them to @p devices.
+    @param devices already scanned devices, which must include the physical volumes of the volume groups
+    @param vgNames names of the volume groups to scan
+*/
+void LvmDevice::scanSystemLVM(QList<Device*>& devices, const QStringList& vgNames)
 {
     LvmDevice::s_OrphanPVs.clear();
 
     QList<LvmDevice*> lvmList;
-    for (const auto &vgName : getVGs()) {
+    for (const auto &vgName : vgNames) {
         lvmList.append(new LvmDevice(vgName));
     }
 
@@ -334,6 +344,15 @@ QString LvmDevice::getUUID(const QString& vgName)
 
 QString LvmDevice::getField(const QString& fieldName, const QString& vgName)
 {
+    QStringList values;
+    if (vgName.isEmpty() && LvmReport::volumeGroupFields(fieldName, values))
+        return values.join(QLatin1Char('\n'));
+    if (!vgName.isEmpty() && fieldName.startsWith(QStringLiteral("lv_")) && LvmReport::logicalVolumeFields(vgName, fieldName, values))
+        return values.join(QLatin1Char('\n'));
+    QString value;
+    if (!vgName.isEmpty() && LvmReport::volumeGroupField(vgName, fieldName, value))
+        return value;
+
     QStringList args = { QStringLiteral("vgs"),
               QStringLiteral("--foreign"),
               QStringLiteral("--readonly"),
@@ -355,6 +374,13 @@ QString LvmDevice::getField(const QString& fieldName, const QString& vgName)
 
 qint64 LvmDevice::getTotalLE(const QString& lvPath)
 {
+    QString vgName, lvSize, extentSize;
+    if (LvmReport::logicalVolumeField(lvPath, QStringLiteral("vg_name"), vgName) &&
+        LvmReport::logicalVolumeField(lvPath, QStringLiteral("lv_size"), lvSize) &&
+        LvmReport::volumeGroupField(vgName, QStringLiteral("vg_extent_size"), extentSize) &&
+        extentSize.toLongLong() > 0)
+        return lvSize.toLongLong() / extentSize.toLongLong();
+
     ExternalCommand cmd(QStringLiteral("lvm"),
             { QStringLiteral("lvdisplay"),
               lvPath});
@@ -108,6 +108,7 @@ protected:
 
 private:
     static void scanSystemLVM(QList<Device*>& devices);
+    static void scanSystemLVM(QList<Device*>& devices, const QStringList& vgNames);
 };
 
 #endif
@@ -0,0 +1,293 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#include "core/lvmreport.h"
+
+#include "util/externalcommand.h"
+
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+
+static QMutex reportMutex(QMutex::Recursive);
+static int scanDepth = 0;
+static bool reportLoaded = false;
+
+static QStringList vgNames;                             // volume groups in report order
+static QHash<QString, LvmReport::Fields> vgTable;       // by vg_name
+static QHash<QString, LvmReport::Fields> lvTable;       // by lv_path
+static QHash<QString, QStringList> lvPathsByVG;         // by vg_name, in report order
+static QHash<QString, LvmReport::Fields> pvTable;       // by pv_name and its canonical path
+static QHash<QString, QStringList> pvNamesByVG;         // by vg_name, orphans under ""
+
+static LvmReport::Fields toFields(const QJsonValue& value)
+{
+    LvmReport::Fields fields;
+    const QJsonObject object = value.toObject();
+    for (auto it = object.constBegin(); it != object.constEnd(); ++it)
+        fields.insert(it.key(), it.value().toString());
+
+    return fields;
+}
+
+/** Takes the snapshot for a scan. Calls must be balanced with endScan(). */
+void LvmReport::beginScan()
+{
+    QMutexLocker locker(&reportMutex);
+    if (scanDepth++ == 0)
+        load();
+}
+
+/** Drops the snapshot once the outermost scan has finished */
+void LvmReport::endScan()
+{
+    QMutexLocker locker(&reportMutex);
+    if (scanDepth > 0 && --scanDepth == 0)
+        clear();
+}
+
+/** @return true if queries are currently answered from a snapshot */
+bool LvmReport::isLoaded()
+{
+    QMutexLocker locker(&reportMutex);
+    return reportLoaded;
+}
+
+bool LvmReport::load()
+{
+    ExternalCommand cmd(QStringLiteral("lvm"),
+                        { QStringLiteral("fullreport"),
+                          QStringLiteral("--foreign"),
+                          QStringLiteral("--readonly"),
+                          QStringLiteral("--units"), QStringLiteral("B"),
+                          QStringLiteral("--nosuffix"),
+                          QStringLiteral("--reportformat"), QStringLiteral("json"),
+                          QStringLiteral("--configreport"), QStringLiteral("vg"),
+                          QStringLiteral("--options"), QStringLiteral("vg_name,vg_uuid,vg_extent_size,vg_extent_count,vg_free_count"),
+                          QStringLiteral("--configreport"), QStringLiteral("lv"),
+                          QStringLiteral("--options"), QStringLiteral("lv_name,lv_path,lv_uuid,lv_size"),
+                          QStringLiteral("--configreport"), QStringLiteral("pv"),
+                          QStringLiteral("--options"), QStringLiteral("pv_name,pv_uuid,pv_used,pe_start,pv_pe_count,pv_pe_alloc_count") },
+                        QProcess::ProcessChannelMode::SeparateChannels);
+
+    // Older LVM versions without JSON reports simply keep using per-field queries
+    if (!cmd.run(-1) || cmd.exitCode() != 0)
+        return false;
+
+    return parse(cmd.rawOutput());
+}
+
+/** Replaces the snapshot with the output of lvm fullreport --reportformat json.
+    @param json the report
+    @return true if the report could be parsed
+*/
+bool LvmReport::parse(const QByteArray& json)
+{
+    QMutexLocker locker(&reportMutex);
+    clear();
+
+    const QJsonDocument document = QJsonDocument::fromJson(json);
+    if (!document.isObject())
+        return false;
+
+    // Every element of "report" describes one volume group, orphan physical volumes come without one
+    const QJsonArray reports = document.object()[QLatin1String("report")].toArray();
+    for (const auto &reportValue : reports) {
+        const QJsonObject report = reportValue.toObject();
+
+        Fields vgFields;
+        const QJsonArray vgs = report[QLatin1String("vg")].toArray();
+        if (!vgs.isEmpty())
+            vgFields = toFields(vgs.first());
+
+        const QString vgName = vgFields.value(QStringLiteral("vg_name"));
+        if (!vgName.isEmpty()) {
+            vgNames.append(vgName);
+            vgTable.insert(vgName, vgFields);
+        }
+
+        for (const auto &lvValue : report[QLatin1String("lv")].toArray()) {
+            Fields lvFields = toFields(lvValue);
+            const QString lvPath = lvFields.value(QStringLiteral("lv_path"));
+            // Hidden logical volumes, e.g. thin pool metadata, have no path
+            if (lvPath.isEmpty())
+                continue;
+
+            lvFields.insert(QStringLiteral("vg_name"), vgName);
+            lvTable.insert(lvPath, lvFields);
+            lvPathsByVG[vgName].append(lvPath);
+        }
+
+        for (const auto &pvValue : report[QLatin1String("pv")].toArray()) {
+            Fields pvFields = toFields(pvValue);
+            const QString pvName = pvFields.value(QStringLiteral("pv_name"));
+            if (pvName.isEmpty() || pvName.startsWith(QLatin1Char('[')))
+                continue;
+
+            // pvs reports the fields of the volume group alongside the physical volume
+            for (auto it = vgFields.constBegin(); it != vgFields.constEnd(); ++it)
+                pvFields.insert(it.key(), it.value());
+            pvFields.insert(QStringLiteral("vg_name"), vgName);
+
+            pvTable.insert(pvName, pvFields);
+            const QString canonicalName = QFileInfo(pvName).canonicalFilePath();
+            if (!canonicalName.isEmpty() && canonicalName != pvName)
+                pvTable.insert(canonicalName, pvFields);
+            pvNamesByVG[vgName].append(pvName);
+        }
+    }
+
+    reportLoaded = true;
+    return true;
+}
+
+/** Drops the snapshot, subsequent queries fall back to running lvm */
+void LvmReport::clear()
+{
+    QMutexLocker locker(&reportMutex);
+    reportLoaded = false;
+    vgNames.clear();
+    vgTable.clear();
+    lvTable.clear();
+    lvPathsByVG.clear();
+    pvTable.clear();
+    pvNamesByVG.clear();
+}
+
+/** Looks up a field of a volume group.
+    @param vgName the volume group name
+    @param fieldName the LVM field name
+    @param value set to the value of the field
+    @return false if the answer has to be obtained from lvm
+*/
+bool LvmReport::volumeGroupField(const QString& vgName, const QString& fieldName, QString& value)
+{
+    QMutexLocker locker(&reportMutex);
+    const auto it = vgTable.constFind(vgName);
+    if (!reportLoaded || it == vgTable.constEnd() || !it->contains(fieldName))
+        return false;
+
+    value = it->value(fieldName);
+    return true;
+}
+
+/** Collects a field of all volume groups.
+    @param fieldName the LVM field name
+    @param values set to one value per volume group
+    @return false if the answer has to be obtained from lvm
+*/
+bool LvmReport::volumeGroupFields(const QString& fieldName, QStringList& values)
+{
+    QMutexLocker locker(&reportMutex);
+    if (!reportLoaded)
+        return false;
+
+    QStringList result;
+    for (const QString& vgName : qAsConst(vgNames)) {
+        const Fields& fields = vgTable[vgName];
+        if (!fields.contains(fieldName))
+            return false;
+        result.append(fields.value(fieldName));
+    }
+
+    values = result;
+    return true;
+}
+
+/** Collects a field of all logical volumes in a volume group.
+    @param vgName the volume group name
+    @param fieldName the LVM field name
+    @param values set to one value per logical volume
+    @return false if the answer has to be obtained from lvm
+*/
+bool LvmReport::logicalVolumeFields(const QString& vgName, const QString& fieldName, QStringList& values)
+{
+    QMutexLocker locker(&reportMutex);
+    if (!reportLoaded || !vgTable.contains(vgName))
+        return false;
+
+    QStringList result;
+    for (const QString& lvPath : lvPathsByVG.value(vgName)) {
+        const Fields& fields = lvTable[lvPath];
+        if (!fields.contains(fieldName))
+            return false;
+        result.append(fields.value(fieldName));
+    }
+
+    values = result;
+    return true;
+}
+
+/** Looks up a field of a logical volume.
+    @param lvPath the logical volume path (e.g. "/dev/vg0/root")
+    @param fieldName the LVM field name
+    @param value set to the value of the field
+    @return false if the answer has to be obtained from lvm
+*/
+bool LvmReport::logicalVolumeField(const QString& lvPath, const QString& fieldName, QString& value)
+{
+    QMutexLocker locker(&reportMutex);
+    const auto it = lvTable.constFind(lvPath);
+    if (!reportLoaded || it == lvTable.constEnd() || !it->contains(fieldName))
+        return false;
+
+    value = it->value(fieldName);
+    return true;
+}
+
+/** Looks up a field of a physical volume. Fields of its volume group can be queried, too.
+    @param pvNode the device node of the physical volume
+    @param fieldName the LVM field name
+    @param value set to the value of the field, empty for volume group fields of orphans
+    @return false if the answer has to be obtained from lvm
+*/
+bool LvmReport::physicalVolumeField(const QString& pvNode, const QString& fieldName, QString& value)
+{
+    QMutexLocker locker(&reportMutex);
+    if (!reportLoaded)
+        return false;
+
+    auto it = pvTable.constFind(pvNode);
+    if (it == pvTable.constEnd())
+        it = pvTable.constFind(QFileInfo(pvNode).canonicalFilePath());
+    if (it == pvTable.constEnd())
+        return false;
+
+    if (!it->contains(fieldName) && !fieldName.startsWith(QStringLiteral("vg_")))
+        return false;
+
+    value = it->value(fieldName);
+    return true;
+}
+
+/** Collects the physical volumes of a volume group.
+    @param vgName the volume group name, empty for orphan physical volumes
+    @param pvNodes set to the device nodes of the physical volumes
+    @return false if the answer has to be obtained from lvm
+*/
+bool LvmReport::physicalVolumes(const QString& vgName, QStringList& pvNodes)
+{
+    QMutexLocker locker(&reportMutex);
+    if (!reportLoaded)
+        return false;
+
+    pvNodes = pvNamesByVG.value(vgName);
+    return true;
+}
@@ -0,0 +1,63 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#ifndef KPMCORE_LVMREPORT_H
+#define KPMCORE_LVMREPORT_H
+
+#include "util/libpartitionmanagerexport.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+/** A snapshot of the LVM state taken with a single lvm fullreport call.
+
+    While a scan is in progress LvmDevice and lvm2_pv answer their field queries
+    from this snapshot instead of running lvm vgs, lvs and pvs for every field.
+    Outside of a scan no snapshot is held and the queries go to lvm directly, so
+    results are never stale after an operation modified LVM metadata.
+
+    Scans nest: the snapshot is taken by the outermost beginScan() and dropped
+    by the matching endScan().
+*/
+class LIBKPMCORE_EXPORT LvmReport
+{
+public:
+    /** Fields of a single report row, keyed by LVM field name (e.g. "vg_extent_size") */
+    typedef QHash<QString, QString> Fields;
+
+public:
+    static void beginScan();
+    static void endScan();
+    static bool isLoaded();
+
+    static bool volumeGroupField(const QString& vgName, const QString& fieldName, QString& value);
+    static bool volumeGroupFields(const QString& fieldName, QStringList& values);
+    static bool logicalVolumeFields(const QString& vgName, const QString& fieldName, QStringList& values);
+    static bool logicalVolumeField(const QString& lvPath, const QString& fieldName, QString& value);
+    static bool physicalVolumeField(const QString& pvNode, const QString& fieldName, QString& value);
+    static bool physicalVolumes(const QString& vgName, QStringList& pvNodes);
+
+    static bool parse(const QByteArray& json);
+    static void clear();
+
+private:
+    static bool load();
+};
+
+#endif
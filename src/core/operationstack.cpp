@@ -18,6 +18,7 @@
 
 #include "core/operationstack.h"
 #include "core/device.h"
+#include "core/lvmdevice.h"
 #include "core/partition.h"
 #include "core/partitiontable.h"
 
@@ -37,6 +38,7 @@
 #include "jobs/setfilesystemlabeljob.h"
 
 #include "fs/filesystemfactory.h"
+#include "fs/lvm2_pv.h"
 
 #include "util/globallog.h"
 
@@ -552,6 +554,143 @@ void OperationStack::addDevice(Device* d)
     emit devicesChanged();
 }
 
+/** Replaces the Device with the same device node, or adds it if there is none
+
+    The existing Device is left alone if it is still in use, see isDeviceInUse().
+
+    @param d pointer to the rescanned Device. Must not be nullptr. OperationStack takes ownership.
+    @return true if the Device was updated or added
+*/
+bool OperationStack::updateDevice(Device* d)
+{
+    Q_ASSERT(d);
+
+    QWriteLocker lockDevices(&lock());
+
+    for (int i = 0; i < previewDevices().size(); ++i) {
+        Device* old = previewDevices()[i];
+        if (old->deviceNode() != d->deviceNode())
+            continue;
+
+        if (isDeviceInUse(*old)) {
+            delete d;
+            return false;
+        }
+
+        previewDevices()[i] = d;
+        delete old;
+        updatePhysicalVolumes();
+        emit devicesChanged();
+        return true;
+    }
+
+    previewDevices().append(d);
+    updatePhysicalVolumes();
+    emit devicesChanged();
+    return true;
+}
+
+/** Removes a Device that has disappeared from the system
+
+    The Device is kept if it is still in use, see isDeviceInUse().
+
+    @param deviceNode the device node of the Device to remove
+    @return true if the Device was removed
+*/
+bool OperationStack::removeDevice(const QString& deviceNode)
+{
+    QWriteLocker lockDevices(&lock());
+
+    for (int i = 0; i < previewDevices().size(); ++i) {
+        Device* d = previewDevices()[i];
+        if (d->deviceNode() != deviceNode)
+            continue;
+
+        if (isDeviceInUse(*d))
+            return false;
+
+        previewDevices().removeAt(i);
+        delete d;
+        updatePhysicalVolumes();
+        emit devicesChanged();
+        return true;
+    }
+
+    return false;
+}
+
+static void collectPartitions(const PartitionNode* node, QList<const Partition*>& partitions)
+{
+    for (const auto &child : node->children()) {
+        partitions.append(child);
+        collectPartitions(child, partitions);
+    }
+}
+
+/** Checks whether a Device must survive a rescan
+
+    A Device is in use if a pending Operation targets it, copies from it or targets one of its
+    Partitions, or if one of its Partitions is a physical volume of a volume group.
+
+    @param d the Device to check
+    @return true if the Device must not be replaced or removed
+*/
+bool OperationStack::isDeviceInUse(const Device& d) const
+{
+    QList<const Partition*> partitions;
+    if (d.partitionTable())
+        collectPartitions(d.partitionTable(), partitions);
+
+    for (const auto &o : operations()) {
+        if (o->targets(d))
+            return true;
+
+        const CopyOperation* copyOp = dynamic_cast<const CopyOperation*>(o);
+        if (copyOp && copyOp->sourceDevice() == d)
+            return true;
+
+        for (const auto &p : qAsConst(partitions))
+            if (o->targets(*p))
+                return true;
+    }
+
+    for (const auto &p : qAsConst(partitions)) {
+        if (LvmDevice::s_DirtyPVs.contains(p) || LvmDevice::s_OrphanPVs.contains(p))
+            return true;
+
+        for (const auto &device : previewDevices()) {
+            const LvmDevice* lvm = dynamic_cast<const LvmDevice*>(device);
+            if (lvm && lvm->physicalVolumes().contains(p))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+/** Rebuilds the list of LVM physical volumes after a Device was replaced, added or removed
+
+    Physical volumes on a new Device that belong to a known volume group are added to that
+    LvmDevice. Must be called with the lock held for writing.
+*/
+void OperationStack::updatePhysicalVolumes()
+{
+    LVM::pvList::list().clear();
+    LVM::pvList::list().append(FS::lvm2_pv::getPVs(previewDevices()));
+
+    for (const auto &device : qAsConst(previewDevices())) {
+        LvmDevice* lvm = dynamic_cast<LvmDevice*>(device);
+        if (!lvm)
+            continue;
+
+        for (const auto &pv : qAsConst(LVM::pvList::list())) {
+            const Partition* p = pv.partition();
+            if (p && pv.vgName() == lvm->name() && !lvm->physicalVolumes().contains(p))
+                lvm->physicalVolumes().append(p);
+        }
+    }
+}
+
 static bool deviceLessThan(const Device* d1, const Device* d2)
 {
     // Display alphabetically sorted disk devices above LVM VGs
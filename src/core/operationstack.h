@@ -90,6 +90,10 @@ public:
 protected:
     void clearDevices();
     void addDevice(Device* d);
+    bool updateDevice(Device* d);
+    bool removeDevice(const QString& deviceNode);
+    bool isDeviceInUse(const Device& d) const;
+    void updatePhysicalVolumes();
     void sortDevices();
 
     bool mergeNewOperation(Operation*& currentOp, Operation*& pushedOp);
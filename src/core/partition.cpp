@@ -200,6 +200,10 @@ qint64 Partition::sectorsUsed() const
 /** @return the minimum number of sectors this Partition must be long */
 qint64 Partition::minimumSectors() const
 {
+    // Some file systems only know how far they can be shrunk by looking at the disk
+    if (state() == State::None)
+        m_FileSystem->updateMinCapacity(deviceNode());
+
     if (roles().has(PartitionRole::Luks))
         return ( fileSystem().minCapacity() + (4096 * 512) ) / sectorSize(); // 4096 is the default cryptsetup payload offset
     return fileSystem().minCapacity() / sectorSize();
@@ -23,14 +23,42 @@
 #include "core/volumemanagerdevice_p.h"
 #include "fs/filesystem.h"
 #include "fs/filesystemfactory.h"
+#include "fs/linuxraidmember.h"
 #include "util/externalcommand.h"
 
 #include <KLocalizedString>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
 #include <QRegularExpression>
+#include <QTextStream>
+
+#include <algorithm>
+#include <limits>
 
 #define d_ptr std::static_pointer_cast<SoftwareRAIDPrivate>(d)
 
+/** Properties of an array read in one pass from sysfs, or from mdadm if sysfs lacks them */
+struct SoftwareRAIDProperties
+{
+    bool valid = false;
+    qint32 raidLevel = -1;
+    qint64 chunkSize = -1;  // in KiB like mdadm reports it, logical sector size of the members for RAID 1
+    qint64 arraySize = -1;
+    QString uuid;
+    QStringList devicePathList;
+};
+
+static QMutex scanMutex(QMutex::Recursive);
+static int scanDepth = 0;
+static QString mdstatContent;
+static bool mdstatLoaded = false;
+static QHash<QString, SoftwareRAIDProperties> propertiesCache;
+
 class SoftwareRAIDPrivate : public VolumeManagerDevicePrivate
 {
 public:
@@ -44,21 +72,142 @@ public:
     SoftwareRAID::Status m_status;
 };
 
+static QString readSysfs(const QString& path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? QString::fromLatin1(file.readAll()).trimmed() : QString();
+}
+
+/** @return the RAID level number of a level name such as "raid5", -1 for linear and container arrays */
+static qint32 levelNumber(const QString& level)
+{
+    QRegularExpression re(QStringLiteral("^raid(\\d+)$"));
+    QRegularExpressionMatch reMatch = re.match(level);
+    return reMatch.hasMatch() ? reMatch.captured(1).toInt() : -1;
+}
+
+/** @return a property from the udev database entry of the block device with number @p majorMinor (e.g. "9:0") */
+static QString udevProperty(const QString& majorMinor, const QString& key)
+{
+    QFile file(QStringLiteral("/run/udev/data/b") + majorMinor);
+    if (majorMinor.isEmpty() || !file.open(QIODevice::ReadOnly))
+        return QString();
+
+    const QByteArray prefix = QByteArrayLiteral("E:") + key.toLatin1() + '=';
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        if (line.startsWith(prefix))
+            return QString::fromLatin1(line.mid(prefix.size()));
+    }
+
+    return QString();
+}
+
+/** @return the size of an array computed from the superblock of one of its members, -1 if unknown */
+static qint64 superblockArraySize(const FS::linuxraidmember::Superblock& superblock)
+{
+    const qint64 size = superblock.componentSize;
+    const qint32 disks = superblock.raidDisks;
+    if (size <= 0 || disks <= 0)
+        return -1;
+
+    switch (superblock.level) {
+    case 0:
+        return size * disks;
+    case 1:
+        return size;
+    case 4:
+    case 5:
+        return size * (disks - 1);
+    case 6:
+        return size * (disks - 2);
+    case 10: {
+        // The layout holds the number of near and far copies
+        const qint32 copies = (superblock.layout & 0xff) * ((superblock.layout >> 8) & 0xff);
+        return copies > 0 ? size * disks / copies : -1;
+    }
+    default:
+        return -1;
+    }
+}
+
+static qint64 logicalSectorSize(const QString& deviceNode)
+{
+    const QString name = QFileInfo(QFileInfo(deviceNode).canonicalFilePath()).fileName();
+    const QString sysfsPath = QFileInfo(QStringLiteral("/sys/class/block/") + name).canonicalFilePath();
+
+    // Partitions share the queue of their disk, which is the parent directory in sysfs
+    qint64 size = readSysfs(sysfsPath + QStringLiteral("/queue/logical_block_size")).toLongLong();
+    if (size <= 0 && !name.isEmpty())
+        size = readSysfs(QFileInfo(sysfsPath).path() + QStringLiteral("/queue/logical_block_size")).toLongLong();
+    if (size > 0)
+        return size;
+
+    ExternalCommand sectorSize(QStringLiteral("blockdev"), { QStringLiteral("--getss"), deviceNode });
+    if (sectorSize.run(-1) && sectorSize.exitCode() == 0)
+        return sectorSize.output().trimmed().toLongLong();
+
+    return -1;
+}
+
+/** Looks up the UUID of an array in mdadm.conf, for arrays neither sysfs nor mdadm know about
+    @param config contents of mdadm.conf
+    @param path the array device node
+*/
+static QString configurationUUID(const QString& config, const QString &path)
+{
+    if (!config.isEmpty()) {
+        QRegularExpression re(QStringLiteral("([\\t\\r\\n\\f\\s]|INACTIVE-)ARRAY \\/dev\\/md([\\/\\w-]+)(.*)"));
+        QRegularExpressionMatchIterator i  = re.globalMatch(config);
+
+        while (i.hasNext()) {
+            QRegularExpressionMatch reMatch = i.next();
+            QString deviceNode = QStringLiteral("/dev/md") + reMatch.captured(2).trimmed();
+            QString otherInfo = reMatch.captured(3).trimmed();
+
+            // Consider device node as name=host:deviceNode when the captured device node string has '-' character
+            // It happens when user have included the device to config file using 'mdadm --examine --scan'
+            if (deviceNode.contains(QLatin1Char('-'))) {
+                QRegularExpression reName(QStringLiteral("name=[\\w:]+\\/dev\\/md\\/([\\/\\w]+)"));
+                QRegularExpressionMatch nameMatch = reName.match(otherInfo);
+
+                if (nameMatch.hasMatch())
+                    deviceNode = nameMatch.captured(1);
+            }
+
+            if (deviceNode == path) {
+                QRegularExpression reUUID(QStringLiteral("(UUID=|uuid=)([\\w:]+)"));
+                QRegularExpressionMatch uuidMatch = reUUID.match(otherInfo);
+
+                if (uuidMatch.hasMatch())
+                    return uuidMatch.captured(2);
+            }
+        }
+    }
+
+    return QString();
+}
+
 SoftwareRAID::SoftwareRAID(const QString& name, SoftwareRAID::Status status, const QString& iconName)
+    : SoftwareRAID(name, status, iconName, properties(QStringLiteral("/dev/") + name))
+{
+}
+
+SoftwareRAID::SoftwareRAID(const QString& name, SoftwareRAID::Status status, const QString& iconName, const SoftwareRAIDProperties& arrayProperties)
     : VolumeManagerDevice(std::make_shared<SoftwareRAIDPrivate>(),
                           name,
                           (QStringLiteral("/dev/") + name),
-                          getChunkSize(QStringLiteral("/dev/") + name),
-                          getTotalChunk(QStringLiteral("/dev/") + name),
+                          arrayProperties.chunkSize,
+                          arrayProperties.arraySize / arrayProperties.chunkSize,
                           iconName,
                           Device::Type::SoftwareRAID_Device)
 {
-    d_ptr->m_raidLevel = getRaidLevel(deviceNode());
+    d_ptr->m_raidLevel = arrayProperties.raidLevel;
     d_ptr->m_chunkSize = logicalSize();
     d_ptr->m_totalChunk = totalLogical();
-    d_ptr->m_arraySize = getArraySize(deviceNode());
-    d_ptr->m_UUID = getUUID(deviceNode());
-    d_ptr->m_devicePathList = getDevicePathList(deviceNode());
+    d_ptr->m_arraySize = arrayProperties.arraySize;
+    d_ptr->m_UUID = arrayProperties.uuid;
+    d_ptr->m_devicePathList = arrayProperties.devicePathList;
     d_ptr->m_status = status;
 
     initPartitions();
@@ -166,6 +315,17 @@ void SoftwareRAID::setStatus(SoftwareRAID::Status status)
 
 void SoftwareRAID::scanSoftwareRAID(QList<Device*>& devices)
 {
+    scanSoftwareRAID(devices, [] (const QString&) { return true; });
+}
+
+/** Scans RAID arrays and appends them to @p devices.
+    @param devices the list to append to
+    @param filter returns true for device nodes (e.g. "/dev/md0") that should be scanned
+*/
+void SoftwareRAID::scanSoftwareRAID(QList<Device*>& devices, const std::function<bool(const QString&)>& filter)
+{
+    beginScan();
+
     QStringList availableInConf;
 
     // TODO: Support custom config files.
@@ -183,15 +343,9 @@ void SoftwareRAID::scanSoftwareRAID(QList<Device*>& devices)
         }
     }
 
-    QFile mdstat(QStringLiteral("/proc/mdstat"));
-
-    if (mdstat.open(QIODevice::ReadOnly)) {
-        QTextStream stream(&mdstat);
-
-        QString content = stream.readAll();
-
-        mdstat.close();
+    const QString content = mdstat();
 
+    if (!content.isEmpty()) {
         QRegularExpression re(QStringLiteral("md([\\/\\w]+)\\s+:\\s+([\\w]+)"));
         QRegularExpressionMatchIterator i  = re.globalMatch(content);
         while (i.hasNext()) {
@@ -200,6 +354,9 @@ void SoftwareRAID::scanSoftwareRAID(QList<Device*>& devices)
             QString deviceNode = QStringLiteral("/dev/md") + reMatch.captured(1).trimmed();
             QString status = reMatch.captured(2).trimmed();
 
+            if (!filter(deviceNode))
+                continue;
+
             SoftwareRAID* d = static_cast<SoftwareRAID *>(CoreBackendManager::self()->backend()->scanDevice(deviceNode));
 
             // Just to prevent segfault in some case
@@ -233,146 +390,50 @@ void SoftwareRAID::scanSoftwareRAID(QList<Device*>& devices)
     }
 
     for (const QString& name : qAsConst(availableInConf)) {
+        if (!filter(QStringLiteral("/dev/") + name))
+            continue;
+
         SoftwareRAID *raidDevice = new SoftwareRAID(name, SoftwareRAID::Status::Inactive);
         devices << raidDevice;
     }
+
+    endScan();
 }
 
 qint32 SoftwareRAID::getRaidLevel(const QString &path)
 {
-    QString output = getDetail(path);
-
-    if (!output.isEmpty()) {
-        QRegularExpression re(QStringLiteral("Raid Level :\\s+\\w+(\\d+)"));
-        QRegularExpressionMatch reMatch = re.match(output);
-        if (reMatch.hasMatch())
-            return reMatch.captured(1).toLongLong();
-    }
-
-    return -1;
+    return properties(path).raidLevel;
 }
 
 qint64 SoftwareRAID::getChunkSize(const QString &path)
 {
-    if (getRaidLevel(path) == 1) {
-        QStringList devices = getDevicePathList(path);
-
-        if (!devices.isEmpty()) {
-            QString device = devices[0];
-            // Look sector size for the first device/partition on the list, as RAID 1 is composed by mirrored devices
-            ExternalCommand sectorSize(QStringLiteral("blockdev"), { QStringLiteral("--getss"), device });
-
-            if (sectorSize.run(-1) && sectorSize.exitCode() == 0) {
-                int sectors = sectorSize.output().trimmed().toLongLong();
-                return sectors;
-            }
-        }
-    }
-    else {
-        QString output = getDetail(path);
-        if (!output.isEmpty()) {
-            QRegularExpression re(QStringLiteral("Chunk Size :\\s+(\\d+)"));
-            QRegularExpressionMatch reMatch = re.match(output);
-            if (reMatch.hasMatch())
-                return reMatch.captured(1).toLongLong();
-        }
-    }
-    return -1;
-
+    return properties(path).chunkSize;
 }
 
 qint64 SoftwareRAID::getTotalChunk(const QString &path)
 {
-    return getArraySize(path) / getChunkSize(path);
+    const SoftwareRAIDProperties p = properties(path);
+    return p.arraySize / p.chunkSize;
 }
 
 qint64 SoftwareRAID::getArraySize(const QString &path)
 {
-    QString output = getDetail(path);
-    if (!output.isEmpty()) {
-        QRegularExpression re(QStringLiteral("Array Size :\\s+(\\d+)"));
-        QRegularExpressionMatch reMatch = re.match(output);
-        if (reMatch.hasMatch())
-            return reMatch.captured(1).toLongLong() * 1024;
-    }
-    return -1;
-
+    return properties(path).arraySize;
 }
 
 QString SoftwareRAID::getUUID(const QString &path)
 {
-    QString output = getDetail(path);
-
-    if (!output.isEmpty()) {
-        QRegularExpression re(QStringLiteral("UUID :\\s+([\\w:]+)"));
-        QRegularExpressionMatch reMatch = re.match(output);
-
-        if (reMatch.hasMatch())
-            return reMatch.captured(1);
-    }
-
-    // If UUID was not found in detail output, it should be searched in config file
-
-    // TODO: Support custom config files.
-    QString config = getRAIDConfiguration(QStringLiteral("/etc/mdadm.conf"));
-
-    if (!config.isEmpty()) {
-        QRegularExpression re(QStringLiteral("([\\t\\r\\n\\f\\s]|INACTIVE-)ARRAY \\/dev\\/md([\\/\\w-]+)(.*)"));
-        QRegularExpressionMatchIterator i  = re.globalMatch(config);
-
-        while (i.hasNext()) {
-            QRegularExpressionMatch reMatch = i.next();
-            QString deviceNode = QStringLiteral("/dev/md") + reMatch.captured(2).trimmed();
-            QString otherInfo = reMatch.captured(3).trimmed();
-
-            // Consider device node as name=host:deviceNode when the captured device node string has '-' character
-            // It happens when user have included the device to config file using 'mdadm --examine --scan'
-            if (deviceNode.contains(QLatin1Char('-'))) {
-                QRegularExpression reName(QStringLiteral("name=[\\w:]+\\/dev\\/md\\/([\\/\\w]+)"));
-                QRegularExpressionMatch nameMatch = reName.match(otherInfo);
-
-                if (nameMatch.hasMatch())
-                    deviceNode = nameMatch.captured(1);
-            }
-
-            if (deviceNode == path) {
-                QRegularExpression reUUID(QStringLiteral("(UUID=|uuid=)([\\w:]+)"));
-                QRegularExpressionMatch uuidMatch = reUUID.match(otherInfo);
-
-                if (uuidMatch.hasMatch())
-                    return uuidMatch.captured(2);
-            }
-        }
-    }
-
-    return QString();
+    return properties(path).uuid;
 }
 
 QStringList SoftwareRAID::getDevicePathList(const QString &path)
 {
-    QStringList result;
-
-    QString detail = getDetail(path);
-
-    if (!detail.isEmpty()) {
-        QRegularExpression re(QStringLiteral("\\s+\\/dev\\/(\\w+)"));
-        QRegularExpressionMatchIterator i = re.globalMatch(detail);
-
-        while (i.hasNext()) {
-            QRegularExpressionMatch match = i.next();
-
-            QString device = QStringLiteral("/dev/") + match.captured(1);
-            if (device != path)
-                result << device;
-        }
-    }
-
-    return result;
+    return properties(path).devicePathList;
 }
 
 bool SoftwareRAID::isRaidPath(const QString &path)
 {
-    return !getDetail(path).isEmpty();
+    return readProperties(path).valid;
 }
 
 bool SoftwareRAID::createSoftwareRAID(Report &report,
@@ -426,16 +487,7 @@ bool SoftwareRAID::reassembleSoftwareRAID(const QString &deviceNode)
 
 bool SoftwareRAID::isRaidMember(const QString &path)
 {
-    QFile mdstat(QStringLiteral("/proc/mdstat"));
-
-    if (!mdstat.open(QIODevice::ReadOnly))
-        return false;
-
-    QTextStream stream(&mdstat);
-
-    QString content = stream.readAll();
-
-    mdstat.close();
+    const QString content = mdstat();
 
     QRegularExpression re(QStringLiteral("(\\w+)\\[\\d+\\]"));
     QRegularExpressionMatchIterator i  = re.globalMatch(content);
@@ -464,10 +516,171 @@ qint64 SoftwareRAID::mappedSector(const QString &partitionPath, qint64 sector) c
     return -1;
 }
 
+/** @return the contents of /proc/mdstat, read only once while a scan is in progress */
+QString SoftwareRAID::mdstat()
+{
+    QMutexLocker locker(&scanMutex);
+    if (scanDepth > 0 && mdstatLoaded)
+        return mdstatContent;
+
+    QFile mdstat(QStringLiteral("/proc/mdstat"));
+    QString content;
+    if (mdstat.open(QIODevice::ReadOnly)) {
+        QTextStream stream(&mdstat);
+        content = stream.readAll();
+        mdstat.close();
+    }
+
+    if (scanDepth > 0) {
+        mdstatContent = content;
+        mdstatLoaded = true;
+    }
+
+    return content;
+}
+
+/** Starts caching /proc/mdstat and array properties. Calls must be balanced with endScan(). */
+void SoftwareRAID::beginScan()
+{
+    QMutexLocker locker(&scanMutex);
+    ++scanDepth;
+}
+
+/** Drops the cached state once the outermost scan has finished */
+void SoftwareRAID::endScan()
+{
+    QMutexLocker locker(&scanMutex);
+    if (scanDepth > 0 && --scanDepth == 0) {
+        mdstatContent.clear();
+        mdstatLoaded = false;
+        propertiesCache.clear();
+    }
+}
+
+/** @return the properties of an array, cached for the duration of a scan */
+SoftwareRAIDProperties SoftwareRAID::properties(const QString& path)
+{
+    {
+        QMutexLocker locker(&scanMutex);
+        const auto it = propertiesCache.constFind(path);
+        if (scanDepth > 0 && it != propertiesCache.constEnd())
+            return *it;
+    }
+
+    // Reading may run mdadm and start the helper, so it is done without the lock held
+    const SoftwareRAIDProperties p = readProperties(path);
+
+    QMutexLocker locker(&scanMutex);
+    if (scanDepth > 0)
+        propertiesCache.insert(path, p);
+    return p;
+}
+
+/** Reads the properties of an array from /sys/block/mdX/md. Anything missing there,
+    e.g. for inactive arrays, is taken from the md superblocks of its members and only
+    then from a single mdadm --detail --export call.
+
+    @param path the array device node (e.g. "/dev/md0" or "/dev/md/name")
+    @return the array properties, invalid if the array does not exist
+*/
+SoftwareRAIDProperties SoftwareRAID::readProperties(const QString& path)
+{
+    SoftwareRAIDProperties p;
+    bool levelKnown = false;
+
+    const QString name = QFileInfo(QFileInfo(path).canonicalFilePath()).fileName();
+    const QString sysfsPath = QStringLiteral("/sys/block/") + name;
+    if (!name.isEmpty() && QFileInfo::exists(sysfsPath + QStringLiteral("/md"))) {
+        p.valid = true;
+        const QString level = readSysfs(sysfsPath + QStringLiteral("/md/level"));
+        p.raidLevel = levelNumber(level);
+        levelKnown = !level.isEmpty();
+
+        const qint64 chunkSize = readSysfs(sysfsPath + QStringLiteral("/md/chunk_size")).toLongLong();
+        if (chunkSize > 0)
+            p.chunkSize = chunkSize / 1024;
+
+        const qint64 sectors = readSysfs(sysfsPath + QStringLiteral("/size")).toLongLong();
+        if (sectors > 0)
+            p.arraySize = sectors * 512;
+
+        p.uuid = udevProperty(readSysfs(sysfsPath + QStringLiteral("/dev")), QStringLiteral("MD_UUID"));
+
+        // Members are listed as md/dev-<name>, ordered by their slot in the array with spares last
+        QList<QPair<int, QString>> members;
+        const QStringList entries = QDir(sysfsPath + QStringLiteral("/md")).entryList({ QStringLiteral("dev-*") }, QDir::Dirs | QDir::System | QDir::NoDotAndDotDot);
+        for (const QString& entry : entries) {
+            bool isSlot;
+            const int slot = readSysfs(sysfsPath + QStringLiteral("/md/") + entry + QStringLiteral("/slot")).toInt(&isSlot);
+            members.append({ isSlot ? slot : std::numeric_limits<int>::max(), QStringLiteral("/dev/") + entry.mid(4).replace(QLatin1Char('!'), QLatin1Char('/')) });
+        }
+        std::sort(members.begin(), members.end());
+        for (const auto &member : qAsConst(members))
+            p.devicePathList.append(member.second);
+    }
+
+    // Arrays that are not assembled are found through the members scanned so far
+    // TODO: Support custom config files.
+    if (p.uuid.isEmpty() && p.devicePathList.isEmpty())
+        p.uuid = configurationUUID(getRAIDConfiguration(QStringLiteral("/etc/mdadm.conf")), path);
+    if (p.devicePathList.isEmpty() && !p.uuid.isEmpty())
+        p.devicePathList = FS::linuxraidmember::arrayMembers(p.uuid);
+
+    if (!p.devicePathList.isEmpty() && (!levelKnown || p.uuid.isEmpty() || p.arraySize < 0)) {
+        FS::linuxraidmember::Superblock superblock;
+        if (FS::linuxraidmember::readSuperblock(p.devicePathList.first(), superblock)) {
+            p.valid = true;
+            if (p.uuid.isEmpty())
+                p.uuid = superblock.arrayUuid;
+            if (!levelKnown)
+                p.raidLevel = superblock.level;
+            levelKnown = true;
+            if (p.chunkSize < 0 && superblock.chunkSize > 0)
+                p.chunkSize = superblock.chunkSize;
+            if (p.arraySize < 0)
+                p.arraySize = superblockArraySize(superblock);
+        }
+    }
+
+    if (!p.valid || !levelKnown || p.uuid.isEmpty() || p.devicePathList.isEmpty()) {
+        const QString detail = getDetail(path);
+        if (!detail.isEmpty()) {
+            p.valid = true;
+
+            const QStringList lines = detail.split(QLatin1Char('\n'), QString::SkipEmptyParts);
+            for (const QString& line : lines) {
+                const int separator = line.indexOf(QLatin1Char('='));
+                if (separator < 0)
+                    continue;
+
+                const QString key = line.left(separator);
+                const QString value = line.mid(separator + 1).trimmed();
+                if (key == QStringLiteral("MD_LEVEL") && p.raidLevel < 0)
+                    p.raidLevel = levelNumber(value);
+                else if (key == QStringLiteral("MD_UUID") && p.uuid.isEmpty())
+                    p.uuid = value;
+                else if (key.startsWith(QStringLiteral("MD_DEVICE_")) && key.endsWith(QStringLiteral("_DEV")) && !p.devicePathList.contains(value))
+                    p.devicePathList.append(value);
+            }
+        }
+    }
+
+    // RAID 1 has no chunks, use the sector size of the mirrored devices instead
+    if (p.raidLevel == 1 && !p.devicePathList.isEmpty())
+        p.chunkSize = logicalSectorSize(p.devicePathList.first());
+
+    // If UUID was not found, it should be searched in config file
+    // TODO: Support custom config files.
+    if (p.uuid.isEmpty())
+        p.uuid = configurationUUID(getRAIDConfiguration(QStringLiteral("/etc/mdadm.conf")), path);
+
+    return p;
+}
+
 QString SoftwareRAID::getDetail(const QString &path)
 {
     ExternalCommand cmd(QStringLiteral("mdadm"),
-                       { QStringLiteral("--misc"), QStringLiteral("--detail"), path });
+                       { QStringLiteral("--misc"), QStringLiteral("--detail"), QStringLiteral("--export"), path });
     return (cmd.run(-1) && cmd.exitCode() == 0) ? cmd.output() : QString();
 }
 
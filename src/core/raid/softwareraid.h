@@ -22,6 +22,10 @@
 #include "util/libpartitionmanagerexport.h"
 #include "util/report.h"
 
+#include <functional>
+
+struct SoftwareRAIDProperties;
+
 class LIBKPMCORE_EXPORT SoftwareRAID : public VolumeManagerDevice
 {
     Q_DISABLE_COPY(SoftwareRAID)
@@ -89,13 +93,24 @@ public:
 
     static bool isRaidMember(const QString& path);
 
+    static QString mdstat();
+
 protected:
     void initPartitions() override;
 
     qint64 mappedSector(const QString &partitionPath, qint64 sector) const override;
 
 private:
+    SoftwareRAID(const QString& name, SoftwareRAID::Status status, const QString& iconName, const SoftwareRAIDProperties& arrayProperties);
+
+    static void beginScan();
+    static void endScan();
+
+    static SoftwareRAIDProperties properties(const QString& path);
+    static SoftwareRAIDProperties readProperties(const QString& path);
+
     static void scanSoftwareRAID(QList<Device*>& devices);
+    static void scanSoftwareRAID(QList<Device*>& devices, const std::function<bool(const QString&)>& filter);
 
     static QString getDetail(const QString& path);
 
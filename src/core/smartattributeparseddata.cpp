@@ -31,8 +31,7 @@
 #define MSECOND_VALID_SHORT_MAX (60ULL * 60ULL * 1000ULL)
 #define MSECOND_VALID_LONG_MAX (30ULL * 365ULL * 24ULL * 60ULL * 60ULL * 1000ULL)
 
-static QMap<qint32, SmartAttributeUnit> tableUnit();
-static SmartQuirk getQuirk(QString model, QString firmware);
+static const QMap<qint32, SmartAttributeUnit>& tableUnit();
 
 /** Creates a new SmartAttributeParsedData object.
     @param disk the reference to the disk that this attribute is allocated to
@@ -61,7 +60,7 @@ SmartAttributeParsedData::SmartAttributeParsedData(SmartDiskInformation *disk,
     m_Quirk(SmartQuirk::None)
 {
     if (disk)
-        m_Quirk = getQuirk(disk->model(), disk->firmware());
+        m_Quirk = disk->quirks();
 
     if (!jsonAttribute.isEmpty()) {
         QString id = QStringLiteral("id");
@@ -395,15 +394,16 @@ bool SmartAttributeParsedData::updateUnit()
         }
     }
 
-    if (tableUnit().contains(id())) {
-        m_PrettyUnit = tableUnit()[id()];
+    const auto unit = tableUnit().constFind(id());
+    if (unit != tableUnit().constEnd()) {
+        m_PrettyUnit = unit.value();
         return true;
     }
 
     return false;
 }
 
-static QMap<qint32, SmartAttributeUnit> tableUnit()
+static QMap<qint32, SmartAttributeUnit> buildTableUnit()
 {
     QMap<qint32, SmartAttributeUnit> table;
     table.insert(1, SmartAttributeUnit::None);
@@ -478,6 +478,13 @@ static QMap<qint32, SmartAttributeUnit> tableUnit()
     return table;
 }
 
+/** @return the unit table, built once per process */
+static const QMap<qint32, SmartAttributeUnit>& tableUnit()
+{
+    static const QMap<qint32, SmartAttributeUnit> table = buildTableUnit();
+    return table;
+}
+
 static const QVector<SmartAttributeParsedData::SmartQuirkDataBase> quirkDatabase()
 {
     typedef SmartAttributeParsedData::SmartQuirkDataBase QuirkDatabase;
@@ -617,26 +624,47 @@ static const QVector<SmartAttributeParsedData::SmartQuirkDataBase> quirkDatabase
     return quirkDb;
 }
 
-static SmartQuirk getQuirk(QString model, QString firmware)
+/** A quirk database entry with its patterns compiled */
+struct SmartQuirkMatcher {
+    QRegularExpression model;
+    QRegularExpression firmware;
+    SmartQuirk quirk;
+};
+
+/** @return the quirk database with compiled and optimized patterns, built once per process */
+static const QVector<SmartQuirkMatcher>& quirkMatchers()
 {
-    const QVector<SmartAttributeParsedData::SmartQuirkDataBase> db = quirkDatabase();
+    static const QVector<SmartQuirkMatcher> matchers = [] {
+        const QVector<SmartAttributeParsedData::SmartQuirkDataBase> db = quirkDatabase();
+
+        QVector<SmartQuirkMatcher> result;
+        result.reserve(db.size());
+        for (const SmartAttributeParsedData::SmartQuirkDataBase &item : db) {
+            SmartQuirkMatcher matcher { QRegularExpression(item.model, QRegularExpression::DontCaptureOption),
+                                        QRegularExpression(item.firmware, QRegularExpression::DontCaptureOption),
+                                        item.quirk };
+            matcher.model.optimize();
+            matcher.firmware.optimize();
+            result.append(matcher);
+        }
+        return result;
+    }();
 
-    QRegularExpression modelRegex;
-    QRegularExpression firmwareRegex;
+    return matchers;
+}
 
-    for (const SmartAttributeParsedData::SmartQuirkDataBase &item : qAsConst(db)) {
-        if (!item.model.isEmpty()) {
-            modelRegex.setPattern(item.model);
-            QRegularExpressionMatch match = modelRegex.match(model);
-            if (!match.hasMatch())
-                continue;
-        }
-        if (!item.firmware.isEmpty()) {
-            firmwareRegex.setPattern(item.firmware);
-            QRegularExpressionMatch match = firmwareRegex.match(firmware);
-            if (!match.hasMatch())
-                continue;
-        }
+/** Look up the quirks of a disk in the quirk database
+    @param model disk model name
+    @param firmware disk firmware version
+    @return the quirks of the first matching entry
+*/
+SmartQuirk SmartAttributeParsedData::quirksFor(const QString &model, const QString &firmware)
+{
+    for (const SmartQuirkMatcher &item : quirkMatchers()) {
+        if (!item.model.pattern().isEmpty() && !item.model.match(model).hasMatch())
+            continue;
+        if (!item.firmware.pattern().isEmpty() && !item.firmware.match(firmware).hasMatch())
+            continue;
         return item.quirk;
     }
 
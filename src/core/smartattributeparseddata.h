@@ -92,6 +92,8 @@ public:
 
     SmartAttributeParsedData(const SmartAttributeParsedData &other);
 
+    static SmartQuirk quirksFor(const QString &model, const QString &firmware);
+
 public:
     quint32 id() const
     {
@@ -36,7 +36,8 @@ SmartDiskInformation::SmartDiskInformation() :
     m_BadAttributeNow(false),
     m_BadAttributeInThePast(false),
     m_SelfTestExecutionStatus(SmartStatus::SelfTestStatus::Success),
-    m_Overall(SmartStatus::Overall::Bad)
+    m_Overall(SmartStatus::Overall::Bad),
+    m_Quirks(SmartQuirk::None)
 {
 }
 
@@ -56,6 +57,12 @@ void SmartDiskInformation::updateBadSectors()
         m_BadSectors = currentPendingSector->prettyValue();
 }
 
+/** Look up the quirks of the disk model and firmware, must be called before attributes are added */
+void SmartDiskInformation::updateQuirks()
+{
+    m_Quirks = SmartAttributeParsedData::quirksFor(m_ModelName, m_FirmwareVersion);
+}
+
 /** Update SMART overall data based on the quantity of bad sectors and the status of SMART attributes */
 void SmartDiskInformation::updateOverall()
 {
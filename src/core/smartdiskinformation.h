@@ -19,13 +19,12 @@
 #ifndef KPMCORE_SMARTDISKINFORMATION_H
 #define KPMCORE_SMARTDISKINFORMATION_H
 
+#include "core/smartattributeparseddata.h"
 #include "core/smartstatus.h"
 
 #include <QList>
 #include <QString>
 
-class SmartAttributeParsedData;
-
 /** Disk information retrieved by SMART.
 
     It includes a list with your SMART attributes.
@@ -48,6 +47,8 @@ public:
 
     bool updatePowerCycle();
 
+    void updateQuirks();
+
     SmartAttributeParsedData *findAttribute(quint32 id);
 
 public:
@@ -106,6 +107,11 @@ public:
         return m_PowerCycles;    /**< @return quantity of power cycles */
     }
 
+    SmartQuirk quirks() const
+    {
+        return m_Quirks;    /**< @return the quirks of this disk model and firmware */
+    }
+
     QList<SmartAttributeParsedData> attributes() const
     {
         return m_Attributes;    /**< @return a list that contains the disk SMART attributes */
@@ -169,6 +175,7 @@ private:
     bool m_BadAttributeInThePast;
     SmartStatus::SelfTestStatus m_SelfTestExecutionStatus;
     SmartStatus::Overall m_Overall;
+    SmartQuirk m_Quirks;
     QList<SmartAttributeParsedData> m_Attributes;
 };
 
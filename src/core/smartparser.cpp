@@ -39,6 +39,17 @@ SmartParser::SmartParser(const QString &device_path) :
 {
 }
 
+/** Creates a new SmartParser object for already captured smartctl output
+    @param device_path device path that the output belongs to
+    @param smart_output JSON output of smartctl --all --json
+*/
+SmartParser::SmartParser(const QString &device_path, const QJsonDocument &smart_output) :
+    m_DevicePath(device_path),
+    m_SmartOutput(smart_output),
+    m_DiskInformation(nullptr)
+{
+}
+
 SmartParser::~SmartParser()
 {
     delete m_DiskInformation;
@@ -92,6 +103,7 @@ bool SmartParser::init()
     m_DiskInformation->setModel(smartJson[model_name].toString());
     m_DiskInformation->setFirmware(smartJson[firmware].toString());
     m_DiskInformation->setSerial(smartJson[serial_number].toString());
+    m_DiskInformation->updateQuirks();
 
     const auto user_capacity_object = smartJson[user_capacity].toObject();
     QString user_capacity_blocks = QStringLiteral("bytes");
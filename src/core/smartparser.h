@@ -33,6 +33,7 @@ class SmartParser
 {
 public:
     explicit SmartParser(const QString &device_path);
+    SmartParser(const QString &device_path, const QJsonDocument &smart_output);
     ~SmartParser();
 
 public:
@@ -0,0 +1,168 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#include "core/ueventmonitor.h"
+
+#include <QHash>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QtEndian>
+
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Multicast group udevd uses to rebroadcast events once rules have been processed
+static const unsigned int udevMonitorGroup = 2;
+
+// Header prepended by libudev to messages sent to udevMonitorGroup
+struct UdevMonitorHeader
+{
+    char prefix[8];
+    quint32 magic;
+    quint32 headerSize;
+    quint32 propertiesOffset;
+    quint32 propertiesLength;
+};
+
+static const quint32 udevMonitorMagic = 0xfeedcafe;
+
+UeventMonitor::UeventMonitor(QObject* parent) :
+    QObject(parent),
+    m_Socket(-1),
+    m_Notifier(nullptr)
+{
+    m_Timer.setSingleShot(true);
+    m_Timer.setInterval(500);
+    connect(&m_Timer, &QTimer::timeout, this, &UeventMonitor::flush);
+}
+
+UeventMonitor::~UeventMonitor()
+{
+    stop();
+}
+
+/** Opens the netlink socket and starts listening for events.
+    @return true on success
+*/
+bool UeventMonitor::start()
+{
+    if (isRunning())
+        return true;
+
+    m_Socket = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (m_Socket < 0)
+        return false;
+
+    sockaddr_nl address = {};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = udevMonitorGroup;
+    if (bind(m_Socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        stop();
+        return false;
+    }
+
+    m_Notifier = new QSocketNotifier(m_Socket, QSocketNotifier::Read, this);
+    connect(m_Notifier, &QSocketNotifier::activated, this, &UeventMonitor::readEvents);
+
+    return true;
+}
+
+/** Closes the socket and drops all events not reported yet. */
+void UeventMonitor::stop()
+{
+    m_Timer.stop();
+    m_Changed.clear();
+    m_Removed.clear();
+
+    delete m_Notifier;
+    m_Notifier = nullptr;
+
+    if (m_Socket >= 0) {
+        close(m_Socket);
+        m_Socket = -1;
+    }
+}
+
+void UeventMonitor::readEvents()
+{
+    char buffer[8192];
+    ssize_t length;
+    while ((length = recv(m_Socket, buffer, sizeof(buffer), 0)) > 0)
+        handleEvent(QByteArray(buffer, length));
+}
+
+void UeventMonitor::handleEvent(const QByteArray& message)
+{
+    if (message.size() < static_cast<int>(sizeof(UdevMonitorHeader)) || !message.startsWith("libudev"))
+        return;
+
+    const UdevMonitorHeader* header = reinterpret_cast<const UdevMonitorHeader*>(message.constData());
+    if (qFromBigEndian(header->magic) != udevMonitorMagic ||
+        header->propertiesOffset + header->propertiesLength > static_cast<quint32>(message.size()))
+        return;
+
+    QHash<QByteArray, QByteArray> properties;
+    const QList<QByteArray> lines = message.mid(header->propertiesOffset, header->propertiesLength).split('\0');
+    for (const QByteArray& line : lines) {
+        int separator = line.indexOf('=');
+        if (separator > 0)
+            properties.insert(line.left(separator), line.mid(separator + 1));
+    }
+
+    if (properties.value("SUBSYSTEM") != "block")
+        return;
+
+    // DEVPATH is .../block/sda for disks and .../block/sda/sda1 for partitions
+    const QList<QByteArray> devPath = properties.value("DEVPATH").split('/');
+    const QByteArray devType = properties.value("DEVTYPE");
+    QString diskName;
+    if (devType == "disk" && devPath.size() >= 1)
+        diskName = QString::fromLocal8Bit(devPath.last());
+    else if (devType == "partition" && devPath.size() >= 2)
+        diskName = QString::fromLocal8Bit(devPath.at(devPath.size() - 2));
+
+    // Device mapper and md devices are volume manager devices, not disks
+    if (diskName.isEmpty() || diskName.startsWith(QStringLiteral("dm-")) || diskName.startsWith(QStringLiteral("md")))
+        return;
+
+    const QString deviceNode = QStringLiteral("/dev/") + diskName;
+    const QByteArray action = properties.value("ACTION");
+    if (action == "remove" && devType == "disk") {
+        m_Changed.remove(deviceNode);
+        m_Removed.insert(deviceNode);
+    }
+    else if (action == "add" || action == "change" || action == "remove") {
+        m_Removed.remove(deviceNode);
+        m_Changed.insert(deviceNode);
+    }
+    else
+        return;
+
+    m_Timer.start();
+}
+
+void UeventMonitor::flush()
+{
+    const QStringList changed = m_Changed.values();
+    const QStringList removed = m_Removed.values();
+    m_Changed.clear();
+    m_Removed.clear();
+
+    if (!changed.isEmpty() || !removed.isEmpty())
+        emit devicesChanged(changed, removed);
+}
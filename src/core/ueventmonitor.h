@@ -0,0 +1,75 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#ifndef KPMCORE_UEVENTMONITOR_H
+#define KPMCORE_UEVENTMONITOR_H
+
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+
+class QSocketNotifier;
+
+/** Listens for block device uevents broadcast by udev.
+
+    Events are collected per whole disk and reported in one batch after the
+    device has been quiet for a short while, so that storms caused by partx
+    or udevadm trigger only result in a single rescan.
+*/
+class UeventMonitor : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(UeventMonitor)
+
+public:
+    explicit UeventMonitor(QObject* parent = nullptr);
+    ~UeventMonitor() override;
+
+public:
+    bool start();
+    void stop();
+
+    bool isRunning() const {
+        return m_Socket >= 0; /**< @return true if the netlink socket is open */
+    }
+
+    void setDebounceInterval(int msec) {
+        m_Timer.setInterval(msec); /**< @param msec quiet time before changes are reported */
+    }
+
+Q_SIGNALS:
+    /** Emitted after an event storm has settled.
+        @param changedDevices disk device nodes that were added or changed
+        @param removedDevices disk device nodes that were removed
+    */
+    void devicesChanged(const QStringList& changedDevices, const QStringList& removedDevices);
+
+private:
+    void readEvents();
+    void handleEvent(const QByteArray& message);
+    void flush();
+
+private:
+    int m_Socket;
+    QSocketNotifier* m_Notifier;
+    QTimer m_Timer;
+    QSet<QString> m_Changed;
+    QSet<QString> m_Removed;
+};
+
+#endif
@@ -20,7 +20,15 @@
 #include "core/volumemanagerdevice_p.h"
 #include "core/device_p.h"
 #include "core/lvmdevice.h"
+#include "core/lvmreport.h"
 #include "core/raid/softwareraid.h"
+#include "core/devicefilter.h"
+
+#include "util/externalcommand.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
 
 /** Constructs an abstract Volume Manager Device with an empty PartitionTable.
  *
@@ -41,8 +49,159 @@ VolumeManagerDevice::VolumeManagerDevice(std::shared_ptr<VolumeManagerDevicePriv
 
 void VolumeManagerDevice::scanDevices(QList<Device*>& devices)
 {
+    beginScan();
     SoftwareRAID::scanSoftwareRAID(devices);
     LvmDevice::scanSystemLVM(devices); // LVM scanner needs all other devices, so should be last
+    endScan();
+}
+
+/** Snapshots LVM and RAID state so that a scan queries lvm, mdadm and /proc/mdstat only once.
+    Calls must be balanced with endScan() and may nest.
+*/
+void VolumeManagerDevice::beginScan()
+{
+    LvmReport::beginScan();
+    SoftwareRAID::beginScan();
+}
+
+/** Drops the snapshots once the outermost scan has finished */
+void VolumeManagerDevice::endScan()
+{
+    SoftwareRAID::endScan();
+    LvmReport::endScan();
+}
+
+static bool wantsType(const DeviceFilter& filter, Device::Type type)
+{
+    return filter.deviceTypes().isEmpty() || filter.deviceTypes().contains(type);
+}
+
+/** @return volume groups selected by @p filter */
+static QStringList selectedVolumeGroups(const DeviceFilter& filter)
+{
+    QStringList vgNames;
+    if (!wantsType(filter, Device::Type::LVM_Device))
+        return vgNames;
+
+    for (const QString& vgName : LvmDevice::getVGs())
+        if (filter.matches(QStringLiteral("/dev/") + vgName, Device::Type::LVM_Device))
+            vgNames.append(vgName);
+
+    return vgNames;
+}
+
+/** @return device nodes of the physical volumes in the given volume groups */
+static QStringList physicalVolumes(const QStringList& vgNames)
+{
+    QStringList pvNodes;
+    if (vgNames.isEmpty())
+        return pvNodes;
+
+    if (LvmReport::isLoaded()) {
+        for (const QString& vgName : vgNames) {
+            QStringList vgPVs;
+            LvmReport::physicalVolumes(vgName, vgPVs);
+            pvNodes.append(vgPVs);
+        }
+        return pvNodes;
+    }
+
+    ExternalCommand cmd(QStringLiteral("lvm"),
+                        { QStringLiteral("pvs"),
+                          QStringLiteral("--foreign"),
+                          QStringLiteral("--readonly"),
+                          QStringLiteral("--noheadings"),
+                          QStringLiteral("--separator"), QStringLiteral(","),
+                          QStringLiteral("--options"), QStringLiteral("pv_name,vg_name") },
+                        QProcess::ProcessChannelMode::SeparateChannels);
+    if (!cmd.run(-1) || cmd.exitCode() != 0)
+        return pvNodes;
+
+    const QStringList lines = cmd.output().split(QLatin1Char('\n'), QString::SkipEmptyParts);
+    for (const QString& line : lines) {
+        const QStringList fields = line.trimmed().split(QLatin1Char(','));
+        if (fields.size() == 2 && vgNames.contains(fields[1].trimmed()))
+            pvNodes.append(fields[0].trimmed());
+    }
+
+    return pvNodes;
+}
+
+/** Resolves a block device to the disks it lives on, following partitions and device mapper or md slaves.
+    @param deviceNode the device node (e.g. "/dev/sda1", "/dev/mapper/luks-1234" or "/dev/md0")
+    @return the disk device nodes (e.g. "/dev/sda")
+*/
+static QStringList baseDisks(const QString& deviceNode, int depth = 0)
+{
+    const QString name = QFileInfo(QFileInfo(deviceNode).canonicalFilePath()).fileName();
+    if (name.isEmpty() || depth > 16)
+        return {};
+
+    const QString sysfsPath = QStringLiteral("/sys/class/block/") + name;
+    const QStringList slaves = QDir(sysfsPath + QStringLiteral("/slaves")).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    if (!slaves.isEmpty()) {
+        QStringList disks;
+        for (const QString& slave : slaves)
+            for (const QString& disk : baseDisks(QStringLiteral("/dev/") + slave, depth + 1))
+                if (!disks.contains(disk))
+                    disks.append(disk);
+        return disks;
+    }
+
+    // For partitions the parent directory in sysfs is the disk
+    if (QFileInfo::exists(sysfsPath + QStringLiteral("/partition")))
+        return { QStringLiteral("/dev/") + QFileInfo(QFileInfo(sysfsPath).canonicalFilePath()).dir().dirName() };
+
+    return { QStringLiteral("/dev/") + name };
+}
+
+/** Scans only volume manager devices selected by @p filter, together with RAID arrays
+    used as physical volumes by selected LVM volume groups.
+
+    @param devices already scanned devices, which must include memberDisks()
+    @param filter selects the volume manager devices
+*/
+void VolumeManagerDevice::scanDevices(QList<Device*>& devices, const DeviceFilter& filter)
+{
+    // Rescans of individual disks must not reset the physical volume lists of known volume groups
+    if (!wantsType(filter, Device::Type::LVM_Device) && !wantsType(filter, Device::Type::SoftwareRAID_Device))
+        return;
+
+    beginScan();
+    const QStringList vgNames = selectedVolumeGroups(filter);
+    const QStringList pvNodes = physicalVolumes(vgNames);
+
+    SoftwareRAID::scanSoftwareRAID(devices, [&filter, &pvNodes] (const QString& deviceNode) {
+        return filter.matches(deviceNode, Device::Type::SoftwareRAID_Device) || pvNodes.contains(deviceNode);
+    });
+    LvmDevice::scanSystemLVM(devices, vgNames);
+    endScan();
+}
+
+/** Finds the disks that hold members of volume manager devices selected by @p filter.
+    @param filter selects the volume manager devices
+    @return disk device nodes that must be scanned to assemble the selected devices
+*/
+QStringList VolumeManagerDevice::memberDisks(const DeviceFilter& filter)
+{
+    beginScan();
+    QStringList members = physicalVolumes(selectedVolumeGroups(filter));
+    endScan();
+
+    if (wantsType(filter, Device::Type::SoftwareRAID_Device)) {
+        const QStringList arrays = QDir(QStringLiteral("/sys/block")).entryList({ QStringLiteral("md*") }, QDir::Dirs | QDir::System | QDir::NoDotAndDotDot);
+        for (const QString& array : arrays)
+            if (filter.matches(QStringLiteral("/dev/") + array, Device::Type::SoftwareRAID_Device))
+                members.append(QStringLiteral("/dev/") + array);
+    }
+
+    QStringList disks;
+    for (const QString& member : qAsConst(members))
+        for (const QString& disk : baseDisks(member))
+            if (!disks.contains(disk))
+                disks.append(disk);
+
+    return disks;
 }
 
 QString VolumeManagerDevice::prettyDeviceNodeList() const
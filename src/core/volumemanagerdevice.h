@@ -26,6 +26,7 @@
 #include <QObject>
 #include <QtGlobal>
 
+class DeviceFilter;
 class VolumeManagerDevicePrivate;
 
 /** A Volume Manager of physical devices represented as an abstract device.
@@ -81,6 +82,11 @@ protected:
 public:
 
     static void scanDevices(QList<Device*>& devices);
+    static void scanDevices(QList<Device*>& devices, const DeviceFilter& filter);
+    static QStringList memberDisks(const DeviceFilter& filter);
+
+    static void beginScan();
+    static void endScan();
 
     /** join deviceNodes together into comma-separated list
      *
@@ -17,6 +17,7 @@
  *************************************************************************/
 
 #include "fs/btrfs.h"
+#include "fs/byteorder.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
@@ -28,8 +29,40 @@
 
 #include <KLocalizedString>
 
+#include <array>
+
 namespace FS
 {
+namespace
+{
+// The primary superblock and its mirrors at 64 MiB and 256 GiB
+constexpr qint64 superblockOffsets[] = { 64 * 1024, 64 * 1024 * 1024, 256LL * 1024 * 1024 * 1024 };
+constexpr int superblockSize = 4096;
+constexpr int checksumSize = 32;
+constexpr quint16 checksumCrc32c = 0;
+
+/** CRC32C (Castagnoli), which btrfs uses for superblock checksums by default */
+quint32 crc32c(const char* data, int size)
+{
+    static const auto table = [] {
+        std::array<quint32, 256> t;
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? (c >> 1) ^ 0x82F63B78 : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    quint32 crc = 0xFFFFFFFF;
+    for (int i = 0; i < size; ++i)
+        crc = (crc >> 8) ^ table[(crc ^ static_cast<quint8>(data[i])) & 0xff];
+
+    return ~crc;
+}
+}
+
 FileSystem::CommandSupportType btrfs::m_GetUsed = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType btrfs::m_GetLabel = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType btrfs::m_Create = FileSystem::cmdSupportNone;
@@ -53,7 +86,7 @@ void btrfs::init()
     m_Create = findExternal(QStringLiteral("mkfs.btrfs")) ? cmdSupportFileSystem : cmdSupportNone;
     m_Check = findExternal(QStringLiteral("btrfs")) ? cmdSupportFileSystem : cmdSupportNone;
     m_Grow = m_Check;
-    m_GetUsed = m_Check;
+    m_GetUsed = cmdSupportCore;
     m_Shrink = (m_Grow != cmdSupportNone && m_GetUsed != cmdSupportNone) ? cmdSupportFileSystem : cmdSupportNone;
 
     m_SetLabel = m_Check;
@@ -67,9 +100,10 @@ void btrfs::init()
     m_GetUUID = cmdSupportCore;
 
     if (m_Create == cmdSupportFileSystem) {
-        ExternalCommand cmd(QStringLiteral("mkfs.btrfs"), QStringList() << QStringLiteral("-O") << QStringLiteral("list-all"));
-        if (cmd.run(-1) && cmd.exitCode() == 0) {
-            QStringList lines = cmd.output().split(QStringLiteral("\n"));
+        int exitCode;
+        QString output;
+        if (probeExternal(QStringLiteral("mkfs.btrfs"), { QStringLiteral("-O"), QStringLiteral("list-all") }, exitCode, output) && exitCode == 0) {
+            QStringList lines = output.split(QStringLiteral("\n"));
 
             // First line is introductory text, we don't need it
             lines.removeFirst();
@@ -120,8 +154,121 @@ int btrfs::maxLabelLength() const
     return 255;
 }
 
+/** Decodes a btrfs superblock.
+    @param data a 4 KiB superblock copy
+    @param superblock receives the superblock fields
+    @return true if the data is a superblock with a valid checksum
+*/
+bool btrfs::parseSuperblock(const QByteArray& data, Superblock& superblock)
+{
+    if (data.size() < superblockSize || data.mid(0x40, 8) != QByteArrayLiteral("_BHRfS_M"))
+        return false;
+
+    // Newer checksum types (xxhash, sha256, blake2) are accepted without verification
+    if (le16(data, 0xC4) == checksumCrc32c && le32(data, 0) != crc32c(data.constData() + checksumSize, superblockSize - checksumSize))
+        return false;
+
+    superblock.fsid = uuidToString(data, 0x20);
+    superblock.generation = le64(data, 0x48);
+    superblock.totalBytes = le64(data, 0x70);
+    superblock.bytesUsed = le64(data, 0x78);
+    superblock.numDevices = le64(data, 0x88);
+
+    // The dev_item describing the member the superblock was read from
+    superblock.deviceId = le64(data, 0xC9);
+    superblock.deviceTotalBytes = le64(data, 0xC9 + 8);
+    superblock.deviceBytesUsed = le64(data, 0xC9 + 16);
+
+    QByteArray label = data.mid(0x12B, 256);
+    if (label.indexOf('\0') >= 0)
+        label.truncate(label.indexOf('\0'));
+    superblock.label = QString::fromUtf8(label);
+
+    return true;
+}
+
+/** Reads the superblock of a btrfs file system member.
+
+    All superblock copies are read with a single helper call. The primary copy is used if
+    its checksum is valid, otherwise the valid mirror with the highest generation.
+
+    @param deviceNode the device node of the member
+    @param superblock receives the superblock fields
+    @return true if a valid superblock was found
+*/
+bool btrfs::readSuperblock(const QString& deviceNode, Superblock& superblock)
+{
+    QList<QPair<qint64, qint64>> ranges;
+    for (qint64 offset : superblockOffsets)
+        ranges.append(qMakePair(offset, static_cast<qint64>(superblockSize)));
+
+    const QList<QByteArray> copies = ExternalCommand::readData(deviceNode, ranges);
+
+    bool found = false;
+    for (int i = 0; i < copies.size(); ++i) {
+        Superblock copy;
+        if (!parseSuperblock(copies[i], copy) || (found && copy.generation <= superblock.generation))
+            continue;
+
+        superblock = copy;
+        found = true;
+        if (i == 0)
+            break;
+    }
+
+    return found;
+}
+
+/** btrfs filesystem resize changes device 1 unless told otherwise, so members of
+    multi-device file systems are addressed by their device id */
+static QString resizeArgument(const QString& deviceNode, qint64 length)
+{
+    btrfs::Superblock superblock;
+    if (btrfs::readSuperblock(deviceNode, superblock) && superblock.numDevices > 1)
+        return QString::number(superblock.deviceId) + QLatin1Char(':') + QString::number(length);
+
+    return QString::number(length);
+}
+
+/** Remembers the device node of a scanned file system.
+    Its superblock is decoded on first use, so scans that skip usage and identity do not read it.
+    @param deviceNode the device node of the file system member
+*/
+void btrfs::scan(const QString& deviceNode)
+{
+    m_ScannedNode = deviceNode;
+    m_SuperblockDecoded = false;
+}
+
+/** Reads the superblock, decoding it only once for the device node passed to scan().
+    @param deviceNode the device node of the file system member
+    @param superblock receives the superblock fields
+    @return true if a valid superblock was found
+*/
+bool btrfs::scannedSuperblock(const QString& deviceNode, Superblock& superblock) const
+{
+    if (deviceNode != m_ScannedNode)
+        return readSuperblock(deviceNode, superblock);
+
+    if (!m_SuperblockDecoded) {
+        m_SuperblockValid = readSuperblock(deviceNode, m_Superblock);
+        m_SuperblockDecoded = true;
+    }
+
+    superblock = m_Superblock;
+    return m_SuperblockValid;
+}
+
 qint64 btrfs::readUsedCapacity(const QString& deviceNode) const
 {
+    // Like btrfs filesystem show, report the space allocated on this member
+    Superblock superblock;
+    if (scannedSuperblock(deviceNode, superblock))
+        return superblock.deviceBytesUsed;
+
+    if (m_Check == cmdSupportNone)
+        return -1;
+
     ExternalCommand cmd(QStringLiteral("btrfs"),
                         { QStringLiteral("filesystem"), QStringLiteral("show"), QStringLiteral("--raw"), deviceNode });
 
@@ -136,6 +283,26 @@ qint64 btrfs::readUsedCapacity(const QString& deviceNode) const
     return -1;
 }
 
+QString btrfs::readLabel(const QString& deviceNode) const
+{
+    // udev knows the label of every file system it has a UUID for
+    if (!FileSystem::readUUID(deviceNode).isEmpty())
+        return FileSystem::readLabel(deviceNode);
+
+    Superblock superblock;
+    return scannedSuperblock(deviceNode, superblock) ? superblock.label : QString();
+}
+
+QString btrfs::readUUID(const QString& deviceNode) const
+{
+    const QString uuid = FileSystem::readUUID(deviceNode);
+    if (!uuid.isEmpty())
+        return uuid;
+
+    Superblock superblock;
+    return scannedSuperblock(deviceNode, superblock) ? superblock.fsid : QString();
+}
+
 bool btrfs::check(Report& report, const QString& deviceNode) const
 {
     ExternalCommand cmd(report, QStringLiteral("btrfs"), { QStringLiteral("check"), QStringLiteral("--repair"), deviceNode });
@@ -163,6 +330,7 @@ bool btrfs::create(Report& report, const QString& deviceNode)
     }
     args << QStringLiteral("--force") << deviceNode;
 
+    m_SuperblockDecoded = false;
     ExternalCommand cmd(report, QStringLiteral("mkfs.btrfs"), args);
     return cmd.run(-1) && cmd.exitCode() == 0;
 }
@@ -176,13 +344,14 @@ bool btrfs::resize(Report& report, const QString& deviceNode, qint64 length) con
     }
 
     bool rval = false;
+    m_SuperblockDecoded = false;
 
     ExternalCommand mountCmd(report, QStringLiteral("mount"),
                              { QStringLiteral("--verbose"),  QStringLiteral("--types"), QStringLiteral("btrfs"), deviceNode, tempDir.path() });
 
     if (mountCmd.run(-1) && mountCmd.exitCode() == 0) {
         ExternalCommand resizeCmd(report, QStringLiteral("btrfs"),
-                                  { QStringLiteral("filesystem"), QStringLiteral("resize"), QString::number(length), tempDir.path() });
+                                  { QStringLiteral("filesystem"), QStringLiteral("resize"), resizeArgument(deviceNode, length), tempDir.path() });
 
         if (resizeCmd.run(-1) && resizeCmd.exitCode() == 0)
             rval = true;
@@ -201,8 +370,9 @@ bool btrfs::resize(Report& report, const QString& deviceNode, qint64 length) con
 
 bool btrfs::resizeOnline(Report& report, const QString& deviceNode, const QString& mountPoint, qint64 length) const
 {
+    m_SuperblockDecoded = false;
     ExternalCommand resizeCmd(report, QStringLiteral("btrfs"),
-                              { QStringLiteral("filesystem"), QStringLiteral("resize"), QString::number(length), mountPoint });
+                              { QStringLiteral("filesystem"), QStringLiteral("resize"), resizeArgument(deviceNode, length), mountPoint });
 
     if (resizeCmd.run(-1) && resizeCmd.exitCode() == 0)
         return true;
@@ -213,6 +383,7 @@ bool btrfs::resizeOnline(Report& report, const QString& deviceNode, const QStrin
 
 bool btrfs::writeLabel(Report& report, const QString& deviceNode, const QString& newLabel)
 {
+    m_SuperblockDecoded = false;
     ExternalCommand cmd(report, QStringLiteral("btrfs"), { QStringLiteral("filesystem"), QStringLiteral("label"), deviceNode, newLabel });
     return cmd.run(-1) && cmd.exitCode() == 0;
 }
@@ -220,12 +391,14 @@ bool btrfs::writeLabel(Report& report, const QString& deviceNode, const QString&
 bool btrfs::writeLabelOnline(Report& report, const QString& deviceNode, const QString& mountPoint, const QString& newLabel)
 {
     Q_UNUSED(deviceNode)
+    m_SuperblockDecoded = false;
     ExternalCommand cmd(report, QStringLiteral("btrfs"), { QStringLiteral("filesystem"), QStringLiteral("label"), mountPoint, newLabel });
     return cmd.run(-1) && cmd.exitCode() == 0;
 }
 
 bool btrfs::updateUUID(Report& report, const QString& deviceNode) const
 {
+    m_SuperblockDecoded = false;
     ExternalCommand cmd(report, QStringLiteral("btrfstune"), { QStringLiteral("-f"), QStringLiteral("-u"), deviceNode });
     return cmd.run(-1) && cmd.exitCode() == 0;
 }
@@ -24,11 +24,12 @@
 
 #include "fs/filesystem.h"
 
+#include <QString>
 #include <QtGlobal>
 
 class Report;
 
-class QString;
+class QByteArray;
 
 namespace FS
 {
@@ -37,13 +38,31 @@ namespace FS
 */
 class LIBKPMCORE_EXPORT btrfs : public FileSystem
 {
+public:
+    /** Fields of a btrfs superblock. All members of a multi-device file system share
+        the file system wide fields; the device fields describe the member it was read from. */
+    struct Superblock {
+        QString fsid;
+        QString label;
+        qint64 generation = 0;
+        qint64 totalBytes = 0;
+        qint64 bytesUsed = 0;
+        qint64 numDevices = 0;
+        qint64 deviceId = 0;
+        qint64 deviceTotalBytes = 0;
+        qint64 deviceBytesUsed = 0;     /**< bytes allocated to chunks on this member */
+    };
+
 public:
     btrfs(qint64 firstsector, qint64 lastsector, qint64 sectorsused, const QString& label, const QVariantMap& features = {});
 
 public:
     void init() override;
 
+    void scan(const QString& deviceNode) override;
     qint64 readUsedCapacity(const QString& deviceNode) const override;
+    QString readLabel(const QString& deviceNode) const override;
+    QString readUUID(const QString& deviceNode) const override;
     bool check(Report& report, const QString& deviceNode) const override;
     bool create(Report& report, const QString& deviceNode) override;
     bool resize(Report& report, const QString& deviceNode, qint64 length) const override;
@@ -107,6 +126,9 @@ public:
     SupportTool supportToolName() const override;
     bool supportToolFound() const override;
 
+    static bool readSuperblock(const QString& deviceNode, Superblock& superblock);
+    static bool parseSuperblock(const QByteArray& data, Superblock& superblock);
+
 public:
     static CommandSupportType m_GetUsed;
     static CommandSupportType m_GetLabel;
@@ -120,6 +142,15 @@ public:
     static CommandSupportType m_SetLabel;
     static CommandSupportType m_UpdateUUID;
     static CommandSupportType m_GetUUID;
+
+private:
+    bool scannedSuperblock(const QString& deviceNode, Superblock& superblock) const;
+
+private:
+    QString m_ScannedNode;
+    mutable bool m_SuperblockDecoded = false;
+    mutable bool m_SuperblockValid = false;
+    mutable Superblock m_Superblock;
 };
 }
 
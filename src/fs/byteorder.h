@@ -0,0 +1,76 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#if !defined(KPMCORE_BYTEORDER_H)
+
+#define KPMCORE_BYTEORDER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtEndian>
+
+/** Helpers for decoding on-disk structures read into a QByteArray.
+
+    Callers must make sure that the data is large enough for the value read at the given offset.
+*/
+namespace FS
+{
+inline quint16 le16(const QByteArray& data, int offset)
+{
+    return qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(data.constData() + offset));
+}
+
+inline quint32 le32(const QByteArray& data, int offset)
+{
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(data.constData() + offset));
+}
+
+inline quint64 le64(const QByteArray& data, int offset)
+{
+    return qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(data.constData() + offset));
+}
+
+inline quint16 be16(const QByteArray& data, int offset)
+{
+    return qFromBigEndian<quint16>(reinterpret_cast<const uchar*>(data.constData() + offset));
+}
+
+inline quint32 be32(const QByteArray& data, int offset)
+{
+    return qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(data.constData() + offset));
+}
+
+inline quint64 be64(const QByteArray& data, int offset)
+{
+    return qFromBigEndian<quint64>(reinterpret_cast<const uchar*>(data.constData() + offset));
+}
+
+/** Formats 16 bytes stored in big endian order as a UUID (e.g. "0b5e1c5a-....").
+    @param data the data holding the UUID
+    @param offset the offset of the UUID in data
+    @return the UUID in lower case
+*/
+inline QString uuidToString(const QByteArray& data, int offset)
+{
+    QByteArray uuid = data.mid(offset, 16).toHex();
+    for (int position : { 20, 16, 12, 8 })
+        uuid.insert(position, '-');
+    return QString::fromLatin1(uuid);
+}
+}
+
+#endif
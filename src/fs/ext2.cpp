@@ -17,15 +17,25 @@
  *************************************************************************/
 
 #include "fs/ext2.h"
+#include "fs/byteorder.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
 
+#include <QByteArray>
 #include <QRegularExpression>
 #include <QString>
 
 namespace FS
 {
+namespace
+{
+constexpr qint64 superblockOffset = 1024;
+constexpr int superblockSize = 1024;
+constexpr quint16 superblockMagic = 0xEF53;
+constexpr quint32 incompat64Bit = 0x80;
+}
+
 FileSystem::CommandSupportType ext2::m_GetUsed = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType ext2::m_GetLabel = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType ext2::m_Create = FileSystem::cmdSupportNone;
@@ -46,7 +56,7 @@ ext2::ext2(qint64 firstsector, qint64 lastsector, qint64 sectorsused, const QStr
 
 void ext2::init()
 {
-    m_GetUsed = findExternal(QStringLiteral("dumpe2fs")) ? cmdSupportFileSystem : cmdSupportNone;
+    m_GetUsed = cmdSupportCore;
     m_GetLabel = cmdSupportCore;
     m_SetLabel = findExternal(QStringLiteral("e2label")) ? cmdSupportFileSystem : cmdSupportNone;
     m_Create = findExternal(QStringLiteral("mkfs.ext2")) ? cmdSupportFileSystem : cmdSupportNone;
@@ -123,8 +133,100 @@ int ext2::maxLabelLength() const
     return 16;
 }
 
+/** Reads the primary superblock of an ext2/3/4 file system.
+    @param deviceNode the device node of the file system
+    @param superblock receives the superblock fields
+    @return true if a valid superblock was found
+*/
+bool ext2::readSuperblock(const QString& deviceNode, Superblock& superblock)
+{
+    QByteArray data;
+    return ExternalCommand::readData(deviceNode, superblockOffset, superblockSize, data) && parseSuperblock(data, superblock);
+}
+
+/** Decodes an ext2/3/4 superblock.
+    @param data the 1 KiB superblock, starting at byte 1024 of the file system
+    @param superblock receives the superblock fields
+    @return true if the data is a valid superblock
+*/
+bool ext2::parseSuperblock(const QByteArray& data, Superblock& superblock)
+{
+    if (data.size() < superblockSize || le16(data, 0x38) != superblockMagic)
+        return false;
+
+    // Block sizes range from 1 KiB to 64 KiB
+    const quint32 logBlockSize = le32(data, 0x18);
+    if (logBlockSize > 6)
+        return false;
+
+    superblock.blockSize = 1024LL << logBlockSize;
+    superblock.featureCompat = le32(data, 0x5C);
+    superblock.featureIncompat = le32(data, 0x60);
+    superblock.featureRoCompat = le32(data, 0x64);
+    superblock.state = le16(data, 0x3A);
+
+    superblock.blockCount = le32(data, 0x04);
+    superblock.freeBlocks = le32(data, 0x0C);
+    if (superblock.featureIncompat & incompat64Bit) {
+        superblock.blockCount |= static_cast<qint64>(le32(data, 0x150)) << 32;
+        superblock.freeBlocks |= static_cast<qint64>(le32(data, 0x158)) << 32;
+    }
+
+    if (superblock.freeBlocks > superblock.blockCount)
+        return false;
+
+    const qint64 lastCheck = le32(data, 0x40) | static_cast<qint64>(static_cast<quint8>(data[0x277])) << 32;
+    superblock.lastCheck = QDateTime::fromMSecsSinceEpoch(lastCheck * 1000, Qt::UTC);
+
+    superblock.uuid = uuidToString(data, 0x68);
+
+    // The label is not terminated if it uses all 16 bytes
+    QByteArray label = data.mid(0x78, 16);
+    if (label.indexOf('\0') >= 0)
+        label.truncate(label.indexOf('\0'));
+    superblock.label = QString::fromUtf8(label);
+
+    return true;
+}
+
+/** Remembers the device node of a scanned file system.
+    Its superblock is decoded on first use, so scans that skip usage and identity do not read it.
+    @param deviceNode the device node of the file system
+*/
+void ext2::scan(const QString& deviceNode)
+{
+    m_ScannedNode = deviceNode;
+    m_SuperblockDecoded = false;
+}
+
+/** Reads the superblock, decoding it only once for the device node passed to scan().
+    @param deviceNode the device node of the file system
+    @param superblock receives the superblock fields
+    @return true if a valid superblock was found
+*/
+bool ext2::scannedSuperblock(const QString& deviceNode, Superblock& superblock) const
+{
+    if (deviceNode != m_ScannedNode)
+        return readSuperblock(deviceNode, superblock);
+
+    if (!m_SuperblockDecoded) {
+        m_SuperblockValid = readSuperblock(deviceNode, m_Superblock);
+        m_SuperblockDecoded = true;
+    }
+
+    superblock = m_Superblock;
+    return m_SuperblockValid;
+}
+
 qint64 ext2::readUsedCapacity(const QString& deviceNode) const
 {
+    Superblock superblock;
+    if (scannedSuperblock(deviceNode, superblock))
+        return (superblock.blockCount - superblock.freeBlocks) * superblock.blockSize;
+
+    if (!findExternal(QStringLiteral("dumpe2fs")))
+        return -1;
+
     ExternalCommand cmd(QStringLiteral("dumpe2fs"), { QStringLiteral("-h"), deviceNode });
 
     if (cmd.run()) {
@@ -156,6 +258,26 @@ qint64 ext2::readUsedCapacity(const QString& deviceNode) const
     return -1;
 }
 
+QString ext2::readLabel(const QString& deviceNode) const
+{
+    // udev knows the label of every file system it has a UUID for
+    if (!FileSystem::readUUID(deviceNode).isEmpty())
+        return FileSystem::readLabel(deviceNode);
+
+    Superblock superblock;
+    return scannedSuperblock(deviceNode, superblock) ? superblock.label : QString();
+}
+
+QString ext2::readUUID(const QString& deviceNode) const
+{
+    const QString uuid = FileSystem::readUUID(deviceNode);
+    if (!uuid.isEmpty())
+        return uuid;
+
+    Superblock superblock;
+    return scannedSuperblock(deviceNode, superblock) ? superblock.uuid : QString();
+}
+
 bool ext2::check(Report& report, const QString& deviceNode) const
 {
     ExternalCommand cmd(report, QStringLiteral("e2fsck"), { QStringLiteral("-f"), QStringLiteral("-y"), QStringLiteral("-v"), deviceNode });
@@ -183,6 +305,7 @@ bool ext2::create(Report& report, const QString& deviceNode)
     }
     args << QStringLiteral("-qF") << deviceNode;
 
+    m_SuperblockDecoded = false;
     ExternalCommand cmd(report, QStringLiteral("mkfs.ext2"), args);
     return cmd.run(-1) && cmd.exitCode() == 0;
 }
@@ -191,12 +314,14 @@ bool ext2::resize(Report& report, const QString& deviceNode, qint64 length) cons
 {
     const QString len = QString::number(length / 512) + QStringLiteral("s");
 
+    m_SuperblockDecoded = false;
     ExternalCommand cmd(report, QStringLiteral("resize2fs"), { deviceNode, len });
     return cmd.run(-1) && cmd.exitCode() == 0;
 }
 
 bool ext2::writeLabel(Report& report, const QString& deviceNode, const QString& newLabel)
 {
+    m_SuperblockDecoded = false;
     ExternalCommand cmd(report, QStringLiteral("e2label"), { deviceNode, newLabel });
     return cmd.run(-1) && cmd.exitCode() == 0;
 }
@@ -209,6 +334,7 @@ bool ext2::writeLabelOnline(Report& report, const QString& deviceNode, const QSt
 
 bool ext2::updateUUID(Report& report, const QString& deviceNode) const
 {
+    m_SuperblockDecoded = false;
     ExternalCommand cmd(report, QStringLiteral("tune2fs"), { QStringLiteral("-U"), QStringLiteral("random"), deviceNode });
     return cmd.run(-1) && cmd.exitCode() == 0;
 }
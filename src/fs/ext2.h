@@ -23,11 +23,13 @@
 
 #include "fs/filesystem.h"
 
+#include <QDateTime>
+#include <QString>
 #include <QtGlobal>
 
 class Report;
 
-class QString;
+class QByteArray;
 
 namespace FS
 {
@@ -36,13 +38,31 @@ namespace FS
 */
 class LIBKPMCORE_EXPORT ext2 : public FileSystem
 {
+public:
+    /** Fields of an ext2/3/4 superblock */
+    struct Superblock {
+        qint64 blockCount = 0;
+        qint64 freeBlocks = 0;
+        qint64 blockSize = 0;
+        QString label;
+        QString uuid;
+        quint32 featureCompat = 0;
+        quint32 featureIncompat = 0;
+        quint32 featureRoCompat = 0;
+        quint16 state = 0;          /**< 1: cleanly unmounted, 2: errors detected */
+        QDateTime lastCheck;
+    };
+
 public:
     ext2(qint64 firstsector, qint64 lastsector, qint64 sectorsused, const QString& label, const QVariantMap& features = {}, FileSystem::Type t = FileSystem::Type::Ext2);
 
 public:
     void init() override;
 
+    void scan(const QString& deviceNode) override;
     qint64 readUsedCapacity(const QString& deviceNode) const override;
+    QString readLabel(const QString& deviceNode) const override;
+    QString readUUID(const QString& deviceNode) const override;
     bool check(Report& report, const QString& deviceNode) const override;
     bool create(Report& report, const QString& deviceNode) override;
     bool resize(Report& report, const QString& deviceNode, qint64 length) const override;
@@ -98,6 +118,9 @@ public:
     SupportTool supportToolName() const override;
     bool supportToolFound() const override;
 
+    static bool readSuperblock(const QString& deviceNode, Superblock& superblock);
+    static bool parseSuperblock(const QByteArray& data, Superblock& superblock);
+
 public:
     static CommandSupportType m_GetUsed;
     static CommandSupportType m_GetLabel;
@@ -111,6 +134,15 @@ public:
     static CommandSupportType m_SetLabel;
     static CommandSupportType m_UpdateUUID;
     static CommandSupportType m_GetUUID;
+
+private:
+    bool scannedSuperblock(const QString& deviceNode, Superblock& superblock) const;
+
+private:
+    QString m_ScannedNode;
+    mutable bool m_SuperblockDecoded = false;
+    mutable bool m_SuperblockValid = false;
+    mutable Superblock m_Superblock;
 };
 }
 
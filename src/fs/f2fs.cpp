@@ -56,8 +56,9 @@ void f2fs::init()
     m_Check = findExternal(QStringLiteral("fsck.f2fs")) ? cmdSupportFileSystem : cmdSupportNone;
 
     if (m_Create == cmdSupportFileSystem) {
-        ExternalCommand cmd(QStringLiteral("mkfs.f2fs"), {});
-        oldVersion = cmd.run(-1) && !cmd.output().contains(QStringLiteral("-f"));
+        int exitCode;
+        QString output;
+        oldVersion = probeExternal(QStringLiteral("mkfs.f2fs"), {}, exitCode, output) && !output.contains(QStringLiteral("-f"));
     }
 
     m_GetLabel = cmdSupportCore;
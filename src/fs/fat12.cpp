@@ -17,6 +17,7 @@
  *************************************************************************/
 
 #include "fs/fat12.h"
+#include "fs/byteorder.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
@@ -30,12 +31,20 @@
 #include <QStringList>
 
 #include <QDebug>
+#include <QtEndian>
 #include <QtMath>
 
 #include <ctime>
 
 namespace FS
 {
+namespace
+{
+// FAT32 tables are streamed in chunks; several chunks are requested with each helper call
+constexpr qint64 fatChunkSize = 4 * 1024 * 1024;
+constexpr int fatChunksPerRead = 4;
+}
+
 FileSystem::CommandSupportType fat12::m_GetUsed = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType fat12::m_GetLabel = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType fat12::m_SetLabel = FileSystem::cmdSupportNone;
@@ -56,7 +65,8 @@ fat12::fat12(qint64 firstsector, qint64 lastsector, qint64 sectorsused, const QS
 
 void fat12::init()
 {
-    m_Create = m_GetUsed = m_Check = findExternal(QStringLiteral("mkfs.fat"), {}, 1) ? cmdSupportFileSystem : cmdSupportNone;
+    m_Create = m_Check = findExternal(QStringLiteral("mkfs.fat"), {}, 1) ? cmdSupportFileSystem : cmdSupportNone;
+    m_GetUsed = cmdSupportCore;
     m_GetLabel = cmdSupportCore;
     m_SetLabel = findExternal(QStringLiteral("fatlabel")) ? cmdSupportFileSystem : cmdSupportNone;
     m_Move = cmdSupportCore;
@@ -115,8 +125,146 @@ QValidator* fat12::labelValidator(QObject *parent) const
     return m_LabelValidator;
 }
 
+/** Counts free entries in (a part of) a file allocation table.
+
+    The loops are kept free of branches so that the compiler can vectorize them.
+
+    @param fat the table data; for FAT12 it has to start at the beginning of the table
+    @param fatBits 12, 16 or 32
+    @param firstEntry index of the first entry to count, relative to the start of @p fat
+    @param entries number of entries to count
+    @return the number of free entries or -1 if @p fat is too short
+*/
+qint64 fat12::countFreeClusters(const QByteArray& fat, int fatBits, qint64 firstEntry, qint64 entries)
+{
+    const uchar* p = reinterpret_cast<const uchar*>(fat.constData());
+    const qint64 lastEntry = firstEntry + entries;
+    qint64 freeClusters = 0;
+
+    if (fatBits == 32) {
+        if (lastEntry * 4 > fat.size())
+            return -1;
+        for (qint64 i = firstEntry; i < lastEntry; ++i)
+            freeClusters += (qFromLittleEndian<quint32>(p + i * 4) & 0x0FFFFFFF) == 0;
+    }
+    else if (fatBits == 16) {
+        if (lastEntry * 2 > fat.size())
+            return -1;
+        for (qint64 i = firstEntry; i < lastEntry; ++i)
+            freeClusters += qFromLittleEndian<quint16>(p + i * 2) == 0;
+    }
+    else {
+        // Two entries are packed into three bytes
+        if ((lastEntry - 1) * 3 / 2 + 2 > fat.size())
+            return -1;
+        for (qint64 i = firstEntry; i < lastEntry; ++i) {
+            const quint16 pair = qFromLittleEndian<quint16>(p + i * 3 / 2);
+            freeClusters += ((i & 1) ? pair >> 4 : pair & 0x0FFF) == 0;
+        }
+    }
+
+    return freeClusters;
+}
+
+/** Reads the cluster usage from the boot sector and the file allocation table.
+
+    FAT32 free cluster counts are taken from the FSInfo sector if it has a valid one,
+    otherwise the first FAT is read and its free entries are counted.
+
+    @param deviceNode the device node of the file system
+    @param usage receives the cluster size and counts
+    @return true if the usage could be determined
+*/
+bool fat12::readUsage(const QString& deviceNode, Usage& usage)
+{
+    QByteArray bootSector;
+    if (!ExternalCommand::readData(deviceNode, 0, 512, bootSector) || le16(bootSector, 510) != 0xAA55)
+        return false;
+
+    const qint64 bytesPerSector = le16(bootSector, 0x0B);
+    const qint64 sectorsPerCluster = static_cast<quint8>(bootSector[0x0D]);
+    const qint64 reservedSectors = le16(bootSector, 0x0E);
+    const qint64 numberOfFats = static_cast<quint8>(bootSector[0x10]);
+    const qint64 rootEntries = le16(bootSector, 0x11);
+    const qint64 fatSize = le16(bootSector, 0x16) != 0 ? le16(bootSector, 0x16) : le32(bootSector, 0x24);
+    const qint64 totalSectors = le16(bootSector, 0x13) != 0 ? le16(bootSector, 0x13) : le32(bootSector, 0x20);
+
+    if (bytesPerSector < 512 || bytesPerSector > 4096 || (bytesPerSector & (bytesPerSector - 1)) != 0 ||
+        sectorsPerCluster == 0 || (sectorsPerCluster & (sectorsPerCluster - 1)) != 0 ||
+        reservedSectors == 0 || numberOfFats == 0 || fatSize == 0)
+        return false;
+
+    const qint64 rootDirSectors = (rootEntries * 32 + bytesPerSector - 1) / bytesPerSector;
+    const qint64 dataSectors = totalSectors - reservedSectors - numberOfFats * fatSize - rootDirSectors;
+    if (dataSectors <= 0)
+        return false;
+
+    usage.clusterSize = bytesPerSector * sectorsPerCluster;
+    usage.clusterCount = dataSectors / sectorsPerCluster;
+    usage.fatBits = usage.clusterCount < 4085 ? 12 : usage.clusterCount < 65525 ? 16 : 32;
+    usage.fromFsInfo = false;
+
+    if (usage.fatBits == 32) {
+        const qint64 fsInfoSector = le16(bootSector, 0x30);
+        QByteArray fsInfo;
+        if (fsInfoSector > 0 && fsInfoSector < reservedSectors &&
+            ExternalCommand::readData(deviceNode, fsInfoSector * bytesPerSector, 512, fsInfo) &&
+            le32(fsInfo, 0) == 0x41615252 && le32(fsInfo, 484) == 0x61417272 && le32(fsInfo, 508) == 0xAA550000 &&
+            le32(fsInfo, 488) <= usage.clusterCount) {
+            usage.freeClusters = le32(fsInfo, 488);
+            usage.fromFsInfo = true;
+            return true;
+        }
+    }
+
+    // Entries 0 and 1 are reserved, data clusters are numbered from 2
+    const qint64 fatOffset = reservedSectors * bytesPerSector;
+    const qint64 fatBytes = usage.fatBits == 12 ? (usage.clusterCount + 1) * 3 / 2 + 2 : (usage.clusterCount + 2) * usage.fatBits / 8;
+    if (fatBytes > fatSize * bytesPerSector)
+        return false;
+
+    usage.freeClusters = 0;
+    qint64 entry = 0;
+    for (qint64 offset = 0; offset < fatBytes; ) {
+        QList<QPair<qint64, qint64>> ranges;
+        for (int i = 0; i < fatChunksPerRead && offset < fatBytes; ++i) {
+            const qint64 length = usage.fatBits == 32 ? qMin(fatChunkSize, fatBytes - offset) : fatBytes;
+            ranges.append(qMakePair(fatOffset + offset, length));
+            offset += length;
+        }
+
+        const QList<QByteArray> chunks = ExternalCommand::readData(deviceNode, ranges);
+        if (chunks.size() != ranges.size())
+            return false;
+
+        for (int i = 0; i < chunks.size(); ++i) {
+            if (chunks[i].size() != ranges[i].second)
+                return false;
+
+            const qint64 entries = usage.fatBits == 12 ? usage.clusterCount + 2 : chunks[i].size() * 8 / usage.fatBits;
+            const qint64 first = entry == 0 ? 2 : 0;
+            const qint64 count = qMin(entries, usage.clusterCount + 2 - entry) - first;
+            const qint64 freeEntries = countFreeClusters(chunks[i], usage.fatBits, first, count);
+            if (freeEntries < 0)
+                return false;
+
+            usage.freeClusters += freeEntries;
+            entry += entries;
+        }
+    }
+
+    return true;
+}
+
 qint64 fat12::readUsedCapacity(const QString& deviceNode) const
 {
+    Usage usage;
+    if (readUsage(deviceNode, usage))
+        return (usage.clusterCount - usage.freeClusters) * usage.clusterSize;
+
+    if (!findExternal(QStringLiteral("fsck.fat")))
+        return -1;
+
     ExternalCommand cmd(QStringLiteral("fsck.fat"), { QStringLiteral("-n"), QStringLiteral("-v"), deviceNode });
 
     // Exit code 1 is returned when FAT dirty bit is set
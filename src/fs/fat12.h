@@ -27,6 +27,7 @@
 
 class Report;
 
+class QByteArray;
 class QString;
 
 namespace FS
@@ -36,6 +37,16 @@ namespace FS
  */
 class LIBKPMCORE_EXPORT fat12 : public FileSystem
 {
+public:
+    /** Cluster usage of a FAT file system */
+    struct Usage {
+        qint64 clusterSize = 0;
+        qint64 clusterCount = 0;
+        qint64 freeClusters = 0;
+        int fatBits = 0;            /**< 12, 16 or 32 */
+        bool fromFsInfo = false;    /**< free count was taken from the FAT32 FSInfo sector */
+    };
+
 public:
     fat12(qint64 firstsector, qint64 lastsector, qint64 sectorsused, const QString& label, const QVariantMap& features = {}, FileSystem::Type t = FileSystem::Type::Fat12);
 
@@ -92,6 +103,9 @@ public:
     SupportTool supportToolName() const override;
     bool supportToolFound() const override;
 
+    static bool readUsage(const QString& deviceNode, Usage& usage);
+    static qint64 countFreeClusters(const QByteArray& fat, int fatBits, qint64 firstEntry, qint64 entries);
+
 protected:
     bool createWithFatSize(Report &report, const QString& deviceNode, int fatSize);
 
@@ -20,61 +20,36 @@
 #include "fs/filesystem.h"
 #include "core/fstab.h"
 
+#include "fs/filesystemtypes.h"
 #include "fs/lvm2_pv.h"
 
 #include "backend/corebackend.h"
 #include "backend/corebackendmanager.h"
 
 #include "util/externalcommand.h"
+#include "util/externaltoolcache.h"
 #include "util/capacity.h"
 #include "util/helpers.h"
+#include "util/mountindex.h"
 
 #include <KLocalizedString>
 
+#include <QAtomicInt>
 #include <QColor>
 #include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QStandardPaths>
 #include <QStorageInfo>
 
-const std::vector<QColor> FileSystem::defaultColorCode =
-{
-{
-    QColor( 220,205,175 ), // unknown
-    QColor( 187,249,207 ), // extended
-    QColor( 102,121,150 ), // ext2
-    QColor( 122,145,180 ), // ext3
-    QColor( 143,170,210 ), // ext4
-    QColor( 155,155,130 ), // swap
-    QColor( 204,179,215 ), // fat16
-    QColor( 229,201,240 ), // fat32
-    QColor( 244,214,255 ), // ntfs
-    QColor( 216,220,135 ), // reiser
-    QColor( 251,255,157 ), // reiser4
-    QColor( 200,255,254 ), // xfs
-    QColor( 137,200,198 ), // jfs
-    QColor( 210,136,142 ), // hfs
-    QColor( 240,165,171 ), // hfs+
-    QColor( 151,220,134 ), // ufs
-    QColor( 220,205,175 ), // unformatted
-    QColor( 173,205,255 ), // btrfs
-    QColor( 176,155,185 ), // hpfs
-    QColor( 170,30,77 ),   // luks
-    QColor( 96,140,85 ),   // ocfs2
-    QColor( 33,137,108 ),  // zfs
-    QColor( 250,230,255 ), // exfat
-    QColor( 242,155,104 ), // nilfs2
-    QColor( 160,210,180 ), // lvm2 pv
-    QColor( 255,170,0 ),   // f2fs
-    QColor( 170,120,255 ), // udf
-    QColor( 177,82,69 ),   // iso9660
-    QColor( 223,39,104 ),  // luks2
-    QColor( 204,179,255 ), // fat12
-    QColor( 255,100,100 ), // linux_raid_member
-    QColor( 110,20,50 ),   // bitlocker
-    QColor( 255,155,174 ), // apfs
-    QColor( 0,170,255 ), // minix
-}
-};
+const std::vector<QColor> FileSystem::defaultColorCode = [] {
+    std::vector<QColor> colors;
+    colors.reserve(FileSystemTypes::typeCount);
+    for (const auto& type : FileSystemTypes::info)
+        colors.emplace_back(type.red, type.green, type.blue);
+    return colors;
+}();
 
 struct FileSystemPrivate {
     FileSystem::Type m_Type;
@@ -86,6 +61,9 @@ struct FileSystemPrivate {
     QString m_UUID;
     QStringList m_AvailableFeatures;
     QVariantMap m_Features;
+    std::function<void(FileSystem&)> m_DetailsLoader;
+    QAtomicInt m_DetailsPending;
+    QMutex m_DetailsMutex{QMutex::Recursive};
 };
 
 /** Creates a new FileSystem object
@@ -154,17 +132,9 @@ QString FileSystem::detectMountPoint(FileSystem* fs, const QString& partitionPat
     if (partitionPath.isEmpty()) // Happens when during initial scan LUKS is closed
         return QString();
 
-    QStringList mountPoints;
-    QFileInfo partitionPathFileInfo(partitionPath);
-    QString partitionCanonicalPath = partitionPathFileInfo.canonicalFilePath();
-    const QList<QStorageInfo> mountedVolumes = QStorageInfo::mountedVolumes();
-    for (const QStorageInfo &storage : mountedVolumes) {
-        if (partitionCanonicalPath == QFileInfo(QString::fromLocal8Bit(storage.device())).canonicalFilePath() ) {
-            mountPoints.append(storage.rootPath());
-        }
-    }
-
-    mountPoints.append(possibleMountPoints(partitionPath));
+    QStringList mountPoints = MountIndex::mountPoints(partitionPath);
+    if (mountPoints.isEmpty())
+        mountPoints = possibleMountPoints(partitionPath);
 
     return mountPoints.isEmpty() ? QString() : mountPoints.first();
 }
@@ -226,6 +196,15 @@ void FileSystem::scan(const QString& deviceNode)
     Q_UNUSED(deviceNode)
 }
 
+/** Finds out how far an existing FileSystem can be shrunk, for file systems where
+    minCapacity() depends on the data on disk. Called when a resize is planned.
+ *  @param deviceNode the device node of the FileSystem
+*/
+void FileSystem::updateMinCapacity(const QString& deviceNode)
+{
+    Q_UNUSED(deviceNode)
+}
+
 /** Resize a FileSystem to a given new length
     @param report Report to write status information to
     @param deviceNode the device node for the Partition the FileSystem is on
@@ -477,6 +456,7 @@ static const KLocalizedString* typeNames()
         kxi18nc("@item filesystem name", "apfs"),
         kxi18nc("@item filesystem name", "minix"),
     };
+    static_assert(sizeof(s) / sizeof(s[0]) == FileSystemTypes::typeCount, "every file system type needs a name");
 
     return s;
 }
@@ -488,6 +468,9 @@ QString FileSystem::nameForType(FileSystem::Type t, const QStringList& languages
 {
     Q_ASSERT(t < Type::__lastType);
 
+    if (languages == QStringList { QStringLiteral("C") })
+        return QLatin1String(FileSystemTypes::infoForType(t).name);
+
     return typeNames()[static_cast<int>(t)].toString(languages);
 }
 
@@ -496,11 +479,25 @@ QString FileSystem::nameForType(FileSystem::Type t, const QStringList& languages
 */
 FileSystem::Type FileSystem::typeForName(const QString& s, const QStringList& languages )
 {
-    for (quint32 i = 0; i < static_cast<int>(Type::__lastType); i++)
-        if (typeNames()[i].toString(languages) == s)
-            return static_cast<FileSystem::Type>(i);
+    if (languages == QStringList { QStringLiteral("C") })
+        return FileSystemTypes::typeForName(s);
+
+    // Translated names are looked up in a table built once per list of languages. An empty
+    // list means the current ones, so key on those to notice when the language changes.
+    static QMutex mutex;
+    static QHash<QString, QHash<QString, FileSystem::Type>> translatedNames;
+
+    QMutexLocker locker(&mutex);
+    const QString key = (languages.isEmpty() ? KLocalizedString::languages() : languages).join(QLatin1Char(':'));
+    auto it = translatedNames.find(key);
+    if (it == translatedNames.end()) {
+        it = translatedNames.insert(key, {});
+        // The first type wins if two names translate the same
+        for (int i = FileSystemTypes::typeCount - 1; i >= 0; --i)
+            it->insert(typeNames()[i].toString(languages), static_cast<FileSystem::Type>(i));
+    }
 
-    return Type::Unknown;
+    return it->value(s, Type::Unknown);
 }
 
 /** @return a QList of all known types */
@@ -589,24 +586,38 @@ qint64 FileSystem::lastSector() const
         return d->m_LastSector;
 }
 
+/** Looks for an external tool without running it.
+    @param cmdName the command name (e.g. "mkfs.ext4")
+    @param args unused, tools used to be run with these arguments to see if they start
+    @param expectedCode unused, the exit code that running the tool with @p args used to return
+    @return true if the tool was found
+*/
 bool FileSystem::findExternal(const QString& cmdName, const QStringList& args, int expectedCode)
 {
-    QString cmdFullPath = QStandardPaths::findExecutable(cmdName);
-    if (cmdFullPath.isEmpty())
-        cmdFullPath = QStandardPaths::findExecutable(cmdName, { QStringLiteral("/sbin/"), QStringLiteral("/usr/sbin/"), QStringLiteral("/usr/local/sbin/") });
-    if (cmdFullPath.isEmpty())
-        return false;
+    Q_UNUSED(args)
+    Q_UNUSED(expectedCode)
 
-    ExternalCommand cmd(cmdFullPath, args);
-    if (!cmd.run())
-        return false;
+    return !ExternalToolCache::resolve(cmdName).isEmpty();
+}
 
-    return cmd.exitCode() == 0 || cmd.exitCode() == expectedCode;
+/** Runs a command on an external tool to detect its features, or returns the cached result
+    from an earlier run on the same executable.
+    @param cmdName the command name (e.g. "mkfs.btrfs")
+    @param args the arguments
+    @param exitCode set to the exit code of the command
+    @param output set to the output of the command
+    @return true if the command could be run
+*/
+bool FileSystem::probeExternal(const QString& cmdName, const QStringList& args, int& exitCode, QString& output)
+{
+    return ExternalToolCache::probe(cmdName, args, exitCode, output);
 }
 
 void FileSystem::addAvailableFeature(const QString& name)
 {
-    d->m_AvailableFeatures.append(name);
+    // init() may run more than once, see FileSystemFactory::init()
+    if (!d->m_AvailableFeatures.contains(name))
+        d->m_AvailableFeatures.append(name);
 }
 
 void FileSystem::addFeature(const QString& name, const QVariant& value)
@@ -643,6 +654,7 @@ void FileSystem::setLastSector(qint64 s)
 
 const QString& FileSystem::label() const
 {
+    loadDetails();
     return d->m_Label;
 }
 
@@ -663,11 +675,13 @@ qint64 FileSystem::sectorSize() const
 
 qint64 FileSystem::sectorsUsed() const
 {
+    loadDetails();
     return d->m_SectorsUsed;
 }
 
 const QString& FileSystem::uuid() const
 {
+    loadDetails();
     return d->m_UUID;
 }
 
@@ -678,15 +692,51 @@ void FileSystem::setSectorSize(qint64 s)
 
 void FileSystem::setSectorsUsed(qint64 s)
 {
+    loadDetails();
     d->m_SectorsUsed = s;
 }
 
 void FileSystem::setLabel(const QString& s)
 {
+    loadDetails();
     d->m_Label = s;
 }
 
 void FileSystem::setUUID(const QString& s)
 {
+    loadDetails();
     d->m_UUID = s;
 }
+
+/** Sets a function that fills in details skipped by a quick scan, such as label, UUID or usage.
+    The loader runs once, the first time label(), uuid() or sectorsUsed() is accessed or when
+    loadDetails() is called.
+    @param loader the function; it may call the setters of the FileSystem passed in
+*/
+void FileSystem::setDetailsLoader(const std::function<void(FileSystem&)>& loader)
+{
+    QMutexLocker locker(&d->m_DetailsMutex);
+    d->m_DetailsLoader = loader;
+    d->m_DetailsPending.storeRelease(loader ? 1 : 0);
+}
+
+bool FileSystem::hasPendingDetails() const
+{
+    return d->m_DetailsPending.loadAcquire() != 0;
+}
+
+void FileSystem::loadDetails() const
+{
+    if (!hasPendingDetails())
+        return;
+
+    QMutexLocker locker(&d->m_DetailsMutex);
+    if (!d->m_DetailsLoader)
+        return;
+
+    // Clear the loader first so that the setters it calls do not run it again
+    const auto loader = std::move(d->m_DetailsLoader);
+    d->m_DetailsLoader = nullptr;
+    loader(const_cast<FileSystem&>(*this));
+    d->m_DetailsPending.storeRelease(0);
+}
@@ -30,6 +30,7 @@
 #include <QtGlobal>
 #include <QUrl>
 
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -123,6 +124,7 @@ public:
 public:
     virtual void init() {}
     virtual void scan(const QString& deviceNode);
+    virtual void updateMinCapacity(const QString& deviceNode);
     virtual qint64 readUsedCapacity(const QString& deviceNode) const;
     virtual QString readLabel(const QString& deviceNode) const;
     virtual bool create(Report& report, const QString& deviceNode);
@@ -303,8 +305,18 @@ public:
     /**< @param s the new UUID */
     void setUUID(const QString& s);
 
+    /**< @param loader reads the details a quick scan skipped; it is run once on first access */
+    void setDetailsLoader(const std::function<void(FileSystem&)>& loader);
+
+    /**< @return true if the details loader has not been run yet */
+    bool hasPendingDetails() const;
+
+    /**< runs the details loader if it has not been run yet */
+    void loadDetails() const;
+
 protected:
     static bool findExternal(const QString& cmdName, const QStringList& args = QStringList(), int exptectedCode = 1);
+    static bool probeExternal(const QString& cmdName, const QStringList& args, int& exitCode, QString& output);
     void addAvailableFeature(const QString& name);
 
     std::unique_ptr<FileSystemPrivate> d;
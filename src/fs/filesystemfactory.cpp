@@ -57,6 +57,8 @@
 #include "backend/corebackendmanager.h"
 #include "backend/corebackend.h"
 
+#include "util/externaltoolcache.h"
+
 FileSystemFactory::FileSystems FileSystemFactory::m_FileSystems;
 
 /** Initializes the instance. */
@@ -98,9 +100,17 @@ void FileSystemFactory::init()
     fileSystems.insert(FileSystem::Type::Xfs, new FS::xfs(-1, -1, -1, QString()));
     fileSystems.insert(FileSystem::Type::Zfs, new FS::zfs(-1, -1, -1, QString()));
 
+    // Tools are only looked up in PATH. The few probes that have to run a tool are
+    // collected in a first pass and run in parallel, unless cached from an earlier start.
+    ExternalToolCache::beginCollecting();
     for (const auto &fs : qAsConst(fileSystems))
         fs->init();
 
+    if (ExternalToolCache::runCollected())
+        for (const auto &fs : qAsConst(fileSystems))
+            fs->init();
+    ExternalToolCache::save();
+
     qDeleteAll(m_FileSystems);
     m_FileSystems.clear();
     m_FileSystems = fileSystems;
@@ -0,0 +1,274 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#if !defined(KPMCORE_FILESYSTEMTYPES_H)
+
+#define KPMCORE_FILESYSTEMTYPES_H
+
+#include "fs/filesystem.h"
+
+#include <QLatin1String>
+#include <QString>
+#include <QtGlobal>
+
+/** Compile time registry of file system types.
+
+    Holds what is known about each FileSystem::Type without an instance: its untranslated
+    name, default color and partition type codes, and the names (and versions) udev and
+    blkid use for it. Names are looked up through perfect hash tables built by the compiler.
+*/
+namespace FileSystemTypes
+{
+struct Info
+{
+    FileSystem::Type type;
+    const char* name;               /**< untranslated name, see FileSystem::nameForType() */
+    quint8 red;                     /**< default color */
+    quint8 green;
+    quint8 blue;
+    const char* gptType;            /**< default GPT partition type GUID, nullptr if there is none */
+    const char* mbrType;            /**< default MBR partition type, nullptr if there is none */
+};
+
+struct UdevName
+{
+    const char* name;               /**< ID_FS_TYPE */
+    const char* version;            /**< ID_FS_VERSION, nullptr if any version matches */
+    FileSystem::Type type;
+};
+
+namespace Detail
+{
+constexpr const char* linuxData = "0FC63DAF-8483-4772-8E79-3D69D8477DE4";
+constexpr const char* basicData = "EBD0A0A2-B9E5-4433-87C0-68B6B72699C7";
+constexpr const char* appleHfs = "48465300-0000-11AA-AA11-00306543ECAC";
+}
+
+/** Indexed by FileSystem::Type */
+constexpr Info info[] = {
+    { FileSystem::Type::Unknown,         "unknown",           220, 205, 175, nullptr, nullptr },
+    { FileSystem::Type::Extended,        "extended",          187, 249, 207, nullptr, nullptr },
+    { FileSystem::Type::Ext2,            "ext2",              102, 121, 150, Detail::linuxData, "83" },
+    { FileSystem::Type::Ext3,            "ext3",              122, 145, 180, Detail::linuxData, "83" },
+    { FileSystem::Type::Ext4,            "ext4",              143, 170, 210, Detail::linuxData, "83" },
+    { FileSystem::Type::LinuxSwap,       "linuxswap",         155, 155, 130, "0657FD6D-A4AB-43C4-84E5-0933C84B4F4F", "82" },
+    { FileSystem::Type::Fat16,           "fat16",             204, 179, 215, Detail::basicData, "6" },
+    { FileSystem::Type::Fat32,           "fat32",             229, 201, 240, Detail::basicData, "c" },
+    { FileSystem::Type::Ntfs,            "ntfs",              244, 214, 255, Detail::basicData, "7" },
+    { FileSystem::Type::ReiserFS,        "reiser",            216, 220, 135, Detail::linuxData, "83" },
+    { FileSystem::Type::Reiser4,         "reiser4",           251, 255, 157, Detail::linuxData, "83" },
+    { FileSystem::Type::Xfs,             "xfs",               200, 255, 254, Detail::linuxData, "83" },
+    { FileSystem::Type::Jfs,             "jfs",               137, 200, 198, Detail::linuxData, "83" },
+    { FileSystem::Type::Hfs,             "hfs",               210, 136, 142, Detail::appleHfs, "af" },
+    { FileSystem::Type::HfsPlus,         "hfsplus",           240, 165, 171, Detail::appleHfs, "af" },
+    { FileSystem::Type::Ufs,             "ufs",               151, 220, 134, nullptr, nullptr },
+    { FileSystem::Type::Unformatted,     "unformatted",       220, 205, 175, nullptr, nullptr },
+    { FileSystem::Type::Btrfs,           "btrfs",             173, 205, 255, Detail::linuxData, "83" },
+    { FileSystem::Type::Hpfs,            "hpfs",              176, 155, 185, nullptr, nullptr },
+    { FileSystem::Type::Luks,            "luks",              170,  30,  77, nullptr, nullptr },
+    { FileSystem::Type::Ocfs2,           "ocfs2",              96, 140,  85, nullptr, nullptr },
+    { FileSystem::Type::Zfs,             "zfs",                33, 137, 108, nullptr, nullptr },
+    { FileSystem::Type::Exfat,           "exfat",             250, 230, 255, Detail::basicData, "7" },
+    { FileSystem::Type::Nilfs2,          "nilfs2",            242, 155, 104, Detail::linuxData, "83" },
+    { FileSystem::Type::Lvm2_PV,         "lvm2 pv",           160, 210, 180, nullptr, nullptr },
+    { FileSystem::Type::F2fs,            "f2fs",              255, 170,   0, nullptr, nullptr },
+    { FileSystem::Type::Udf,             "udf",               170, 120, 255, Detail::basicData, "7" },
+    { FileSystem::Type::Iso9660,         "iso9660",           177,  82,  69, nullptr, nullptr },
+    { FileSystem::Type::Luks2,           "luks2",             223,  39, 104, nullptr, nullptr },
+    { FileSystem::Type::Fat12,           "fat12",             204, 179, 255, Detail::basicData, "6" },
+    { FileSystem::Type::LinuxRaidMember, "linux_raid_member", 255, 100, 100, nullptr, nullptr },
+    { FileSystem::Type::BitLocker,       "BitLocker",         110,  20,  50, nullptr, nullptr },
+    { FileSystem::Type::Apfs,            "apfs",              255, 155, 174, nullptr, nullptr },
+    { FileSystem::Type::Minix,           "minix",               0, 170, 255, nullptr, nullptr },
+};
+
+/** Names used by udev and blkid. Entries sharing a name must be adjacent. */
+constexpr UdevName udevNames[] = {
+    { "ext2",              nullptr, FileSystem::Type::Ext2 },
+    { "ext3",              nullptr, FileSystem::Type::Ext3 },
+    { "ext4",              nullptr, FileSystem::Type::Ext4 },
+    { "ext4dev",           nullptr, FileSystem::Type::Ext4 },
+    { "swap",              nullptr, FileSystem::Type::LinuxSwap },
+    { "ntfs",              nullptr, FileSystem::Type::Ntfs },
+    { "reiserfs",          nullptr, FileSystem::Type::ReiserFS },
+    { "reiser4",           nullptr, FileSystem::Type::Reiser4 },
+    { "xfs",               nullptr, FileSystem::Type::Xfs },
+    { "jfs",               nullptr, FileSystem::Type::Jfs },
+    { "hfs",               nullptr, FileSystem::Type::Hfs },
+    { "hfsplus",           nullptr, FileSystem::Type::HfsPlus },
+    { "ufs",               nullptr, FileSystem::Type::Ufs },
+    { "vfat",              "FAT32", FileSystem::Type::Fat32 },
+    { "vfat",              "FAT16", FileSystem::Type::Fat16 },
+    { "vfat",              "FAT12", FileSystem::Type::Fat12 },
+    { "btrfs",             nullptr, FileSystem::Type::Btrfs },
+    { "ocfs2",             nullptr, FileSystem::Type::Ocfs2 },
+    { "zfs_member",        nullptr, FileSystem::Type::Zfs },
+    { "hpfs",              nullptr, FileSystem::Type::Hpfs },
+    { "crypto_LUKS",       "1",     FileSystem::Type::Luks },
+    { "crypto_LUKS",       "2",     FileSystem::Type::Luks2 },
+    { "exfat",             nullptr, FileSystem::Type::Exfat },
+    { "nilfs2",            nullptr, FileSystem::Type::Nilfs2 },
+    { "LVM2_member",       nullptr, FileSystem::Type::Lvm2_PV },
+    { "f2fs",              nullptr, FileSystem::Type::F2fs },
+    { "udf",               nullptr, FileSystem::Type::Udf },
+    { "iso9660",           nullptr, FileSystem::Type::Iso9660 },
+    { "linux_raid_member", nullptr, FileSystem::Type::LinuxRaidMember },
+    { "BitLocker",         nullptr, FileSystem::Type::BitLocker },
+    { "apfs",              nullptr, FileSystem::Type::Apfs },
+    { "minix",             nullptr, FileSystem::Type::Minix },
+};
+
+constexpr int typeCount = static_cast<int>(sizeof(info) / sizeof(info[0]));
+constexpr int udevNameCount = static_cast<int>(sizeof(udevNames) / sizeof(udevNames[0]));
+
+namespace Detail
+{
+constexpr int tableSize = 256;
+
+constexpr bool equal(const char* a, const char* b)
+{
+    while (*a && *a == *b) {
+        ++a;
+        ++b;
+    }
+    return *a == *b;
+}
+
+/** FNV-1a, the seed is mixed into the offset basis */
+constexpr quint32 hash(const char* s, quint32 seed)
+{
+    quint32 h = 2166136261u ^ seed;
+    for (; *s; ++s)
+        h = (h ^ static_cast<quint8>(*s)) * 16777619u;
+    return h;
+}
+
+constexpr bool typesInOrder()
+{
+    for (int i = 0; i < typeCount; ++i)
+        if (static_cast<int>(info[i].type) != i)
+            return false;
+    return true;
+}
+
+/** Keys of a perfect hash table are read through a function returning the key of entry i,
+    nullptr for entries that should not get a slot of their own */
+constexpr const char* typeKey(int i)
+{
+    return info[i].name;
+}
+
+constexpr const char* udevKey(int i)
+{
+    return i > 0 && equal(udevNames[i].name, udevNames[i - 1].name) ? nullptr : udevNames[i].name;
+}
+
+struct Table
+{
+    quint32 seed;
+    qint8 slots[tableSize];         /**< entry index or -1 */
+};
+
+template <typename Key>
+constexpr bool isPerfect(Key key, int count, quint32 seed)
+{
+    bool used[tableSize] = {};
+    for (int i = 0; i < count; ++i) {
+        if (key(i) == nullptr)
+            continue;
+        const quint32 slot = hash(key(i), seed) % tableSize;
+        if (used[slot])
+            return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+template <typename Key>
+constexpr Table makeTable(Key key, int count)
+{
+    Table table { 0, {} };
+    while (!isPerfect(key, count, table.seed))
+        ++table.seed;
+
+    for (int i = 0; i < tableSize; ++i)
+        table.slots[i] = -1;
+    for (int i = 0; i < count; ++i)
+        if (key(i) != nullptr)
+            table.slots[hash(key(i), table.seed) % tableSize] = static_cast<qint8>(i);
+
+    return table;
+}
+
+constexpr Table typeTable = makeTable(typeKey, typeCount);
+constexpr Table udevTable = makeTable(udevKey, udevNameCount);
+
+/** @return the slot of @p s in @p table, -1 if @p s cannot be a key */
+inline int slot(const Table& table, const QString& s)
+{
+    quint32 h = 2166136261u ^ table.seed;
+    for (const QChar c : s) {
+        if (c.unicode() > 0xff)
+            return -1;
+        h = (h ^ static_cast<quint8>(c.unicode())) * 16777619u;
+    }
+    return table.slots[h % tableSize];
+}
+}
+
+static_assert(typeCount == static_cast<int>(FileSystem::Type::__lastType), "every file system type needs an entry");
+static_assert(Detail::typesInOrder(), "entries must be in the order of FileSystem::Type");
+
+/** @return the registry entry of @p type */
+inline Info infoForType(FileSystem::Type type)
+{
+    Q_ASSERT(type < FileSystem::Type::__lastType);
+    return info[static_cast<int>(type)];
+}
+
+/** @param name an untranslated name as returned by FileSystem::nameForType(type, { "C" })
+    @return the type with that name, FileSystem::Type::Unknown if there is none */
+inline FileSystem::Type typeForName(const QString& name)
+{
+    const int i = Detail::slot(Detail::typeTable, name);
+    return i >= 0 && name == QLatin1String(info[i].name) ? info[i].type : FileSystem::Type::Unknown;
+}
+
+/** @return true if udev and blkid use @p name for one of the known types */
+inline bool isUdevName(const QString& name)
+{
+    const int i = Detail::slot(Detail::udevTable, name);
+    return i >= 0 && name == QLatin1String(udevNames[i].name);
+}
+
+/** @param name the file system type reported by udev or blkid, e.g. "vfat"
+    @param version the file system version reported along with it, e.g. "FAT32"
+    @return the matching type, FileSystem::Type::Unknown if there is none */
+inline FileSystem::Type typeForUdevName(const QString& name, const QString& version)
+{
+    if (!isUdevName(name))
+        return FileSystem::Type::Unknown;
+
+    for (int i = Detail::slot(Detail::udevTable, name); i < udevNameCount && name == QLatin1String(udevNames[i].name); ++i)
+        if (udevNames[i].version == nullptr || version == QLatin1String(udevNames[i].version))
+            return udevNames[i].type;
+
+    return FileSystem::Type::Unknown;
+}
+}
+
+#endif
@@ -16,6 +16,8 @@
  *************************************************************************/
 
 #include "fs/jfs.h"
+#include "fs/byteorder.h"
+#include "fs/superblockdecoder.h"
 
 #include "util/externalcommand.h"
 #include "util/report.h"
@@ -29,6 +31,56 @@
 
 namespace FS
 {
+namespace
+{
+constexpr qint64 superblockOffset = 0x8000;
+constexpr qint64 inodeTableOffset = 0xb000;     // primary aggregate inode table
+constexpr int inodeSize = 512;
+constexpr int blockMapInode = 2;
+constexpr int xtreeRootOffset = 224;            // in the inode
+constexpr int xtreeHeaderSize = 32;
+constexpr quint8 xtreeLeaf = 0x02;
+
+/** The free block count is kept in the control page of the block allocation map,
+    whose first extent is found in the xtree root of the block map inode */
+qint64 usedCapacity(const QList<QByteArray>& data, const QString& deviceNode)
+{
+    const QByteArray& superblock = data[0];
+    const QByteArray& inodeTable = data[1];
+    if (superblock.size() < 256 || !superblock.startsWith("JFS1") || inodeTable.size() < (blockMapInode + 1) * inodeSize)
+        return -1;
+
+    const qint64 blockSize = static_cast<qint32>(le32(superblock, 16));
+    if (blockSize < 512 || (blockSize & (blockSize - 1)))
+        return -1;
+
+    if (le32(inodeTable, blockMapInode * inodeSize + 8) != blockMapInode)
+        return -1;
+
+    const int root = blockMapInode * inodeSize + xtreeRootOffset;
+    if (!(static_cast<quint8>(inodeTable[root + 16]) & xtreeLeaf) || le16(inodeTable, root + 18) <= 2)
+        return -1;
+
+    // First extent descriptor: flag, reserved, offset (40 bits), length (24 bits), address (40 bits)
+    const int extent = root + xtreeHeaderSize;
+    const quint32 lengthAddress = le32(inodeTable, extent + 8);
+    const qint64 address = (static_cast<qint64>(lengthAddress >> 24) << 32) | le32(inodeTable, extent + 12);
+    if (address <= 0)
+        return -1;
+
+    QByteArray controlPage;
+    if (!ExternalCommand::readData(deviceNode, address * blockSize, 16, controlPage))
+        return -1;
+
+    const qint64 mapSize = le64(controlPage, 0);
+    const qint64 freeBlocks = le64(controlPage, 8);
+    if (mapSize <= 0 || freeBlocks < 0 || freeBlocks > mapSize)
+        return -1;
+
+    return (mapSize - freeBlocks) * blockSize;
+}
+}
+
 FileSystem::CommandSupportType jfs::m_GetUsed = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType jfs::m_GetLabel = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType jfs::m_Create = FileSystem::cmdSupportNone;
@@ -46,7 +98,8 @@ jfs::jfs(qint64 firstsector, qint64 lastsector, qint64 sectorsused, const QStrin
 
 void jfs::init()
 {
-    m_GetUsed = findExternal(QStringLiteral("jfs_debugfs")) ? cmdSupportFileSystem : cmdSupportNone;
+    SuperblockDecoder::registerDecoder(FileSystem::Type::Jfs, { { superblockOffset, 4096 }, { inodeTableOffset, 4096 } }, usedCapacity);
+    m_GetUsed = cmdSupportCore;
     m_GetLabel = cmdSupportCore;
     m_SetLabel = findExternal(QStringLiteral("jfs_tune"), { QStringLiteral("-V") }) ? cmdSupportFileSystem : cmdSupportNone;
     m_Create = findExternal(QStringLiteral("mkfs.jfs"),{ QStringLiteral("-V") }) ? cmdSupportFileSystem : cmdSupportNone;
@@ -94,6 +147,10 @@ int jfs::maxLabelLength() const
 
 qint64 jfs::readUsedCapacity(const QString& deviceNode) const
 {
+    const qint64 used = SuperblockDecoder::readUsedCapacity(type(), deviceNode);
+    if (used >= 0)
+        return used;
+
     ExternalCommand cmd(QStringLiteral("jfs_debugfs"), QStringList() << deviceNode);
 
     if (cmd.write(QByteArrayLiteral("dm")) && cmd.start()) {
@@ -16,13 +16,277 @@
  *************************************************************************/
 
 #include "fs/linuxraidmember.h"
+#include "fs/byteorder.h"
+
+#include "util/externalcommand.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QtEndian>
+
+#include <algorithm>
+#include <limits>
 
 namespace FS
 {
+namespace
+{
+constexpr quint32 mdMagic = 0xa92b4efc;
+constexpr int superblockSize = 4096;
+constexpr int v1HeaderSize = 256;
+
+// 0.90 superblocks are stored in host byte order, in 32 bit words
+constexpr int v0ChecksumWord = 38;
+constexpr int v0ThisDiskWord = 992;
+constexpr quint32 v0DiskFaulty = 1 << 0;
+constexpr quint32 v0DiskActive = 1 << 1;
+constexpr quint32 v0DiskSync = 1 << 2;
+
+// Members seen so far, by array UUID and device node
+QMutex membersMutex;
+QMap<QString, QMap<QString, qint32>> members;
+
+quint32 word(const QByteArray& data, int index)
+{
+    return qFromUnaligned<quint32>(data.constData() + index * 4);
+}
+
+/** md checksums add up 32 bit words and fold the carry back in */
+quint32 foldChecksum(quint64 sum)
+{
+    return static_cast<quint32>((sum & 0xffffffff) + (sum >> 32));
+}
+
+/** @return the size of a block device in bytes from sysfs, -1 if unknown */
+qint64 deviceSize(const QString& deviceNode)
+{
+    const QString name = QFileInfo(QFileInfo(deviceNode).canonicalFilePath()).fileName();
+    QFile file(QStringLiteral("/sys/class/block/%1/size").arg(name));
+    if (name.isEmpty() || !file.open(QIODevice::ReadOnly))
+        return -1;
+
+    bool ok;
+    const qint64 sectors = file.readAll().trimmed().toLongLong(&ok);
+    return ok ? sectors * 512 : -1;
+}
+
+bool parseVersion0(const QByteArray& data, linuxraidmember::Superblock& superblock)
+{
+    if (word(data, 0) != mdMagic || word(data, 1) != 0 || word(data, 2) != 90)
+        return false;
+
+    quint64 sum = 0;
+    for (int i = 0; i < superblockSize / 4; ++i)
+        sum += i == v0ChecksumWord ? 0 : word(data, i);
+    if (foldChecksum(sum) != word(data, v0ChecksumWord))
+        return false;
+
+    superblock.version = QStringLiteral("0.90");
+    superblock.arrayUuid = QStringLiteral("%1:%2:%3:%4").arg(word(data, 5), 8, 16, QLatin1Char('0'))
+                                                           .arg(word(data, 13), 8, 16, QLatin1Char('0'))
+                                                           .arg(word(data, 14), 8, 16, QLatin1Char('0'))
+                                                           .arg(word(data, 15), 8, 16, QLatin1Char('0'));
+    superblock.name = QString();
+    const qint32 level = static_cast<qint32>(word(data, 7));
+    superblock.level = level >= 0 ? level : -1;
+    superblock.layout = static_cast<qint32>(word(data, 64));
+    superblock.chunkSize = word(data, 65) / 1024;
+    superblock.raidDisks = static_cast<qint32>(word(data, 10));
+    superblock.componentSize = word(data, 8) * 1024LL;
+    superblock.dataOffset = 0;
+
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    superblock.events = (static_cast<quint64>(word(data, 39)) << 32) | word(data, 40);
+#else
+    superblock.events = (static_cast<quint64>(word(data, 40)) << 32) | word(data, 39);
+#endif
+
+    // Descriptor of this member: number, major, minor, raid_disk, state
+    const quint32 state = word(data, v0ThisDiskWord + 4);
+    if (state & v0DiskFaulty)
+        superblock.role = linuxraidmember::Faulty;
+    else if (state & (v0DiskActive | v0DiskSync))
+        superblock.role = static_cast<qint32>(word(data, v0ThisDiskWord + 3));
+    else
+        superblock.role = linuxraidmember::Spare;
+
+    return true;
+}
+
+bool parseVersion1(const QByteArray& data, qint64 offset, linuxraidmember::Superblock& superblock)
+{
+    if (le32(data, 0) != mdMagic || le32(data, 4) != 1)
+        return false;
+
+    // The superblock records where it is stored, which tells 1.0, 1.1 and 1.2 apart
+    if (static_cast<qint64>(le64(data, 144)) * 512 != offset)
+        return false;
+
+    const quint32 maxDevices = le32(data, 220);
+    const int size = v1HeaderSize + static_cast<int>(maxDevices) * 2;
+    if (maxDevices > (superblockSize - v1HeaderSize) / 2)
+        return false;
+
+    quint64 sum = 0;
+    for (int i = 0; i + 4 <= size; i += 4)
+        sum += i == 216 ? 0 : le32(data, i);
+    if (size % 4)
+        sum += le16(data, size - 2);
+    if (foldChecksum(sum) != le32(data, 216))
+        return false;
+
+    superblock.version = offset == 0 ? QStringLiteral("1.1") : offset == 4096 ? QStringLiteral("1.2") : QStringLiteral("1.0");
+
+    QByteArray uuid = data.mid(16, 16).toHex();
+    uuid.insert(24, ':').insert(16, ':').insert(8, ':');
+    superblock.arrayUuid = QString::fromLatin1(uuid);
+
+    QByteArray name = data.mid(32, 32);
+    if (name.indexOf('\0') >= 0)
+        name.truncate(name.indexOf('\0'));
+    superblock.name = QString::fromUtf8(name);
+
+    const qint32 level = static_cast<qint32>(le32(data, 72));
+    superblock.level = level >= 0 ? level : -1;
+    superblock.layout = static_cast<qint32>(le32(data, 76));
+    superblock.componentSize = static_cast<qint64>(le64(data, 80)) * 512;
+    superblock.chunkSize = le32(data, 88) / 2;
+    superblock.raidDisks = static_cast<qint32>(le32(data, 92));
+    superblock.dataOffset = static_cast<qint64>(le64(data, 128)) * 512;
+    superblock.events = le64(data, 200);
+
+    const quint32 deviceNumber = le32(data, 160);
+    const quint16 role = deviceNumber < maxDevices ? le16(data, v1HeaderSize + deviceNumber * 2) : 0xffff;
+    if (role == 0xffff)
+        superblock.role = linuxraidmember::Spare;
+    else if (role == 0xfffe)
+        superblock.role = linuxraidmember::Faulty;
+    else if (role == 0xfffd)
+        superblock.role = linuxraidmember::Journal;
+    else
+        superblock.role = role;
+
+    return true;
+}
+}
 
 linuxraidmember::linuxraidmember(qint64 firstsector, qint64 lastsector, qint64 sectorsused, const QString& label, const QVariantMap& features) :
     FileSystem(firstsector, lastsector, sectorsused, label, features, FileSystem::Type::LinuxRaidMember)
 {
 }
 
+void linuxraidmember::scan(const QString& deviceNode)
+{
+    // Also remembers the member for arrayMembers()
+    m_ScannedNode = deviceNode;
+    m_SuperblockValid = readSuperblock(deviceNode, m_Superblock);
+}
+
+/** Returns the superblock decoded by scan(), or reads it if the file system was scanned on another node.
+    @param deviceNode the device node of the member
+    @param superblock receives the superblock fields
+    @return true if a valid superblock was found
+*/
+bool linuxraidmember::scannedSuperblock(const QString& deviceNode, Superblock& superblock) const
+{
+    if (deviceNode != m_ScannedNode)
+        return readSuperblock(deviceNode, superblock);
+
+    superblock = m_Superblock;
+    return m_SuperblockValid;
+}
+
+QString linuxraidmember::readLabel(const QString& deviceNode) const
+{
+    Superblock superblock;
+    return scannedSuperblock(deviceNode, superblock) ? superblock.name : QString();
+}
+
+QString linuxraidmember::readUUID(const QString& deviceNode) const
+{
+    Superblock superblock;
+    return scannedSuperblock(deviceNode, superblock) ? superblock.arrayUuid : QString();
+}
+
+/** Decodes an md superblock.
+    @param data 4 KiB read from @p offset
+    @param offset where the data was read from, 1.x superblocks must have been read from the offset they record
+    @param superblock receives the superblock fields
+    @return true if the data is an md superblock with a valid checksum
+*/
+bool linuxraidmember::parseSuperblock(const QByteArray& data, qint64 offset, Superblock& superblock)
+{
+    if (data.size() < superblockSize)
+        return false;
+
+    return parseVersion1(data, offset, superblock) || parseVersion0(data, superblock);
+}
+
+/** Reads the md superblock of an array member.
+
+    All places a superblock can be stored at (4 KiB from the start for 1.2, the start for 1.1,
+    near the end for 1.0 and 0.90) are read with a single helper call. The member is remembered
+    under the array UUID, see arrayMembers().
+
+    @param deviceNode the device node of the member
+    @param superblock receives the superblock fields
+    @return true if a valid superblock was found
+*/
+bool linuxraidmember::readSuperblock(const QString& deviceNode, Superblock& superblock)
+{
+    QList<QPair<qint64, qint64>> ranges = { qMakePair(4096LL, static_cast<qint64>(superblockSize)),
+                                            qMakePair(0LL, static_cast<qint64>(superblockSize)) };
+
+    const qint64 size = deviceSize(deviceNode);
+    if (size >= 128 * 1024) {
+        ranges.append(qMakePair(((size / 512 - 16) & ~7LL) * 512, static_cast<qint64>(superblockSize)));
+        ranges.append(qMakePair((size & ~0xffffLL) - 0x10000, static_cast<qint64>(superblockSize)));
+    }
+
+    const QList<QByteArray> copies = ExternalCommand::readData(deviceNode, ranges);
+
+    bool found = false;
+    for (int i = 0; i < copies.size() && !found; ++i)
+        found = parseSuperblock(copies[i], ranges[i].first, superblock);
+
+    QMutexLocker locker(&membersMutex);
+    for (auto it = members.begin(); it != members.end(); ) {
+        it->remove(deviceNode);
+        if (it->isEmpty())
+            it = members.erase(it);
+        else
+            ++it;
+    }
+
+    if (found)
+        members[superblock.arrayUuid].insert(deviceNode, superblock.role);
+
+    return found;
+}
+
+/** @param arrayUuid the UUID of an md array
+    @return device nodes of its members read so far, ordered by their slot with spares last
+*/
+QStringList linuxraidmember::arrayMembers(const QString& arrayUuid)
+{
+    QList<QPair<qint32, QString>> ordered;
+    {
+        QMutexLocker locker(&membersMutex);
+        const QMap<QString, qint32> arrayMembers = members.value(arrayUuid);
+        for (auto it = arrayMembers.constBegin(); it != arrayMembers.constEnd(); ++it)
+            ordered.append(qMakePair(it.value() >= 0 ? it.value() : std::numeric_limits<qint32>::max(), it.key()));
+    }
+    std::sort(ordered.begin(), ordered.end());
+
+    QStringList result;
+    for (const auto& member : qAsConst(ordered))
+        result.append(member.second);
+
+    return result;
+}
+
 }
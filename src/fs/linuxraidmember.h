@@ -22,9 +22,13 @@
 
 #include "fs/filesystem.h"
 
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
 class Report;
 
-class QString;
+class QByteArray;
 
 namespace FS
 {
@@ -33,8 +37,55 @@ namespace FS
  */
 class LIBKPMCORE_EXPORT linuxraidmember : public FileSystem
 {
+public:
+    /** Roles of members that do not hold a slot in the array */
+    enum Role : qint32 {
+        Spare = -1,
+        Faulty = -2,
+        Journal = -3
+    };
+
+    /** Fields of an md superblock, metadata version 0.90 or 1.x */
+    struct Superblock {
+        QString version;                /**< "0.90", "1.0", "1.1" or "1.2" */
+        QString arrayUuid;              /**< formatted like mdadm does */
+        QString name;                   /**< array name, 1.x only */
+        qint32 level = -1;              /**< RAID level, -1 for linear and other levels without a number */
+        qint32 layout = 0;
+        qint64 chunkSize = -1;          /**< in KiB */
+        qint32 raidDisks = 0;
+        qint32 role = Spare;            /**< slot in the array or a Role */
+        quint64 events = 0;
+        qint64 dataOffset = 0;          /**< in bytes */
+        qint64 componentSize = -1;      /**< bytes of each member used by the array */
+    };
+
 public:
     linuxraidmember(qint64 firstsector, qint64 lastsector, qint64 sectorsused, const QString& label, const QVariantMap& features = {});
+
+public:
+    void scan(const QString& deviceNode) override;
+    QString readLabel(const QString& deviceNode) const override;
+    QString readUUID(const QString& deviceNode) const override;
+
+    CommandSupportType supportGetLabel() const override {
+        return cmdSupportCore;
+    }
+    CommandSupportType supportGetUUID() const override {
+        return cmdSupportCore;
+    }
+
+    static bool readSuperblock(const QString& deviceNode, Superblock& superblock);
+    static bool parseSuperblock(const QByteArray& data, qint64 offset, Superblock& superblock);
+    static QStringList arrayMembers(const QString& arrayUuid);
+
+private:
+    bool scannedSuperblock(const QString& deviceNode, Superblock& superblock) const;
+
+private:
+    QString m_ScannedNode;
+    bool m_SuperblockValid = false;
+    Superblock m_Superblock;
 };
 }
 
@@ -18,6 +18,7 @@
  *************************************************************************/
 
 #include "fs/luks.h"
+#include "fs/byteorder.h"
 #include "fs/lvm2_pv.h"
 
 #include "fs/filesystemfactory.h"
@@ -29,8 +30,12 @@
 
 #include <cmath>
 
+#include <QCryptographicHash>
 #include <QDebug>
 #include <QDialog>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QJsonDocument>
@@ -46,6 +51,60 @@
 
 namespace FS
 {
+namespace
+{
+constexpr int luks1HeaderSize = 592;
+constexpr int luks2BinaryHeaderSize = 4096;
+constexpr qint64 luks2DefaultHeaderSize = 16384;
+constexpr qint64 luks2MaxHeaderSize = 4 * 1024 * 1024;
+constexpr int luks2ChecksumOffset = 448;
+constexpr int luks2ChecksumSize = 64;
+
+/** @return a zero terminated string field of a header */
+QString stringField(const QByteArray& data, int offset, int size)
+{
+    QByteArray field = data.mid(offset, size);
+    if (field.indexOf('\0') >= 0)
+        field.truncate(field.indexOf('\0'));
+    return QString::fromLatin1(field);
+}
+
+/** @return the first entry of a LUKS2 JSON object such as "segments" or "digests" */
+QJsonObject firstEntry(const QJsonObject& object)
+{
+    return object.isEmpty() ? QJsonObject() : object.constBegin().value().toObject();
+}
+
+/** @return the sysfs name (e.g. "dm-0") of a block device node */
+QString kernelName(const QString& deviceNode)
+{
+    return QFileInfo(QFileInfo(deviceNode).canonicalFilePath()).fileName();
+}
+
+/** Verifies the checksum of a LUKS2 header, which covers the binary header with
+    the checksum field zeroed and the JSON area */
+bool verifyLuks2Checksum(const QByteArray& data, qint64 headerSize)
+{
+    const QString algorithm = stringField(data, 72, 32);
+    QCryptographicHash::Algorithm hash;
+    if (algorithm == QStringLiteral("sha256"))
+        hash = QCryptographicHash::Sha256;
+    else if (algorithm == QStringLiteral("sha1"))
+        hash = QCryptographicHash::Sha1;
+    else if (algorithm == QStringLiteral("sha512"))
+        hash = QCryptographicHash::Sha512;
+    else
+        return false;
+
+    QByteArray header = data.left(headerSize);
+    const QByteArray stored = header.mid(luks2ChecksumOffset, luks2ChecksumSize);
+    header.replace(luks2ChecksumOffset, luks2ChecksumSize, QByteArray(luks2ChecksumSize, 0));
+
+    const QByteArray digest = QCryptographicHash::hash(header, hash);
+    return stored.startsWith(digest);
+}
+}
+
 FileSystem::CommandSupportType luks::m_GetUsed = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType luks::m_GetLabel = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType luks::m_Create = FileSystem::cmdSupportNone;
@@ -110,6 +169,20 @@ bool luks::supportToolFound() const
     return m_cryptsetupFound && ((m_isCryptOpen && m_innerFs) ? m_innerFs->supportToolFound() : true);
 }
 
+qint64 luks::minCapacity() const
+{
+    if (m_isCryptOpen && m_innerFs)
+        return m_innerFs->minCapacity();
+    return FileSystem::minCapacity();
+}
+
+void luks::updateMinCapacity(const QString& deviceNode)
+{
+    Q_UNUSED(deviceNode)
+    if (m_isCryptOpen && m_innerFs)
+        m_innerFs->updateMinCapacity(mapperName());
+}
+
 FileSystem::SupportTool luks::supportToolName() const
 {
     if (m_isCryptOpen && m_innerFs && m_cryptsetupFound)
@@ -340,7 +413,7 @@ void luks::loadInnerFileSystem(const QString& mapperNode)
                                                     *this);
     setLabel(m_innerFs->readLabel(mapperNode));
     setUUID(m_innerFs->readUUID(mapperNode));
-    if (m_innerFs->supportGetUsed() == FileSystem::cmdSupportFileSystem)
+    if (m_innerFs->supportGetUsed() != FileSystem::cmdSupportNone)
         setSectorsUsed(static_cast<qint64>(std::ceil((m_innerFs->readUsedCapacity(mapperNode) + payloadOffset()) / static_cast<double>(sectorSize()) )));
     m_innerFs->scan(mapperNode);
 }
@@ -535,6 +608,12 @@ QString luks::readOuterUUID(const QString &deviceNode) const
     if ( deviceNode.isEmpty() )
         return QString();
 
+    Header header;
+    if (readHeader(deviceNode, header)) {
+        const_cast< QString& >( m_outerUuid ) = header.uuid;
+        return header.uuid;
+    }
+
     ExternalCommand cmd(QStringLiteral("cryptsetup"),
                         { QStringLiteral("luksUUID"), deviceNode });
     if (cmd.run()) {
@@ -567,6 +646,22 @@ bool luks::updateUUID(Report& report, const QString& deviceNode) const
 
 void luks::getMapperName(const QString& deviceNode)
 {
+    // An open LUKS device holds a device mapper device whose UUID starts with CRYPT-
+    const QDir holders(QStringLiteral("/sys/class/block/%1/holders").arg(kernelName(deviceNode)));
+    if (holders.exists()) {
+        m_MapperName = QString();
+        const QStringList holderNames = holders.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+        for (const QString& holder : holderNames) {
+            QFile uuidFile(holders.filePath(holder + QStringLiteral("/dm/uuid")));
+            QFile nameFile(holders.filePath(holder + QStringLiteral("/dm/name")));
+            if (uuidFile.open(QIODevice::ReadOnly) && uuidFile.readAll().startsWith("CRYPT-") && nameFile.open(QIODevice::ReadOnly)) {
+                m_MapperName = QStringLiteral("/dev/mapper/") + QString::fromLocal8Bit(nameFile.readAll().trimmed());
+                break;
+            }
+        }
+        return;
+    }
+
     ExternalCommand cmd(QStringLiteral("lsblk"),
                         { QStringLiteral("--list"),
                           QStringLiteral("--noheadings"),
@@ -591,8 +686,110 @@ void luks::getMapperName(const QString& deviceNode)
     }
 }
 
+/** Decodes a LUKS1 header or one copy of a LUKS2 header.
+    @param data the header, for LUKS2 including its JSON area
+    @param header receives the header fields
+    @return true if the data is a valid header; LUKS2 checksums are verified
+*/
+bool luks::parseHeader(const QByteArray& data, Header& header)
+{
+    if (data.size() < luks1HeaderSize || !(data.startsWith("LUKS\xba\xbe") || data.startsWith("SKUL\xba\xbe")))
+        return false;
+
+    header.version = be16(data, 6);
+    if (header.version == 1) {
+        if (!data.startsWith("LUKS\xba\xbe"))
+            return false;
+
+        header.cipherName = stringField(data, 8, 32);
+        header.cipherMode = stringField(data, 40, 32);
+        header.hashName = stringField(data, 72, 32);
+        header.payloadOffset = be32(data, 104) * 512LL;
+        header.keySize = be32(data, 108) * 8LL;
+        header.uuid = stringField(data, 168, 40);
+        header.label = QString();
+        header.sequenceId = 0;
+        return true;
+    }
+
+    if (header.version != 2 || data.size() < luks2BinaryHeaderSize)
+        return false;
+
+    const qint64 headerSize = be64(data, 8);
+    if (headerSize <= luks2BinaryHeaderSize || headerSize > luks2MaxHeaderSize || data.size() < headerSize ||
+        !verifyLuks2Checksum(data, headerSize))
+        return false;
+
+    header.sequenceId = be64(data, 16);
+    header.label = QString::fromUtf8(stringField(data, 24, 48).toLatin1());
+    header.uuid = stringField(data, 168, 40);
+
+    const QByteArray jsonArea = data.mid(luks2BinaryHeaderSize, headerSize - luks2BinaryHeaderSize);
+    const QJsonObject json = QJsonDocument::fromJson(jsonArea.left(jsonArea.indexOf('\0'))).object();
+    const QJsonObject segment = firstEntry(json[QLatin1String("segments")].toObject());
+    const QJsonObject keyslot = firstEntry(json[QLatin1String("keyslots")].toObject());
+    const QJsonObject digest = firstEntry(json[QLatin1String("digests")].toObject());
+
+    // "aes-xts-plain64" is split like LUKS1 stores it
+    const QString encryption = segment[QLatin1String("encryption")].toString();
+    header.cipherName = encryption.section(QLatin1Char('-'), 0, 0);
+    header.cipherMode = encryption.section(QLatin1Char('-'), 1);
+    header.hashName = digest[QLatin1String("hash")].toString();
+    header.keySize = keyslot.contains(QLatin1String("key_size")) ? keyslot[QLatin1String("key_size")].toInt() * 8LL : -1;
+    header.payloadOffset = segment.contains(QLatin1String("offset")) ? segment[QLatin1String("offset")].toString().toLongLong() : -1;
+
+    return true;
+}
+
+/** Reads the LUKS header of a device.
+
+    LUKS2 has two header copies; the valid one with the higher sequence id is used.
+    Headers of the default size are read with a single helper call.
+
+    @param deviceNode the device node of the LUKS container
+    @param header receives the header fields
+    @return true if a valid header was found
+*/
+bool luks::readHeader(const QString& deviceNode, Header& header)
+{
+    QList<QByteArray> copies = ExternalCommand::readData(deviceNode, { qMakePair(0LL, luks2DefaultHeaderSize),
+                                                                        qMakePair(luks2DefaultHeaderSize, luks2DefaultHeaderSize) });
+    if (copies.isEmpty() || copies[0].size() < luks1HeaderSize)
+        return false;
+
+    if (be16(copies[0], 6) == 1)
+        return parseHeader(copies[0], header);
+
+    // Non-default LUKS2 header sizes need a second read
+    const qint64 headerSize = copies[0].size() >= 16 ? static_cast<qint64>(be64(copies[0], 8)) : 0;
+    if (headerSize != luks2DefaultHeaderSize && headerSize > luks2BinaryHeaderSize && headerSize <= luks2MaxHeaderSize)
+        copies = ExternalCommand::readData(deviceNode, { qMakePair(0LL, headerSize), qMakePair(headerSize, headerSize) });
+
+    bool found = false;
+    for (const QByteArray& copy : qAsConst(copies)) {
+        Header candidate;
+        if (parseHeader(copy, candidate) && (!found || candidate.sequenceId > header.sequenceId)) {
+            header = candidate;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
 void luks::getLuksInfo(const QString& deviceNode)
 {
+    Header header;
+    if (readHeader(deviceNode, header)) {
+        m_CipherName = header.cipherName.isEmpty() ? QStringLiteral("---") : header.cipherName;
+        m_CipherMode = header.cipherMode.isEmpty() ? QStringLiteral("---") : header.cipherMode;
+        m_HashName = header.hashName.isEmpty() ? QStringLiteral("---") : header.hashName;
+        m_KeySize = header.keySize;
+        m_PayloadOffset = header.payloadOffset;
+        m_outerUuid = header.uuid;
+        return;
+    }
+
     ExternalCommand cmd(QStringLiteral("cryptsetup"), { QStringLiteral("luksDump"), deviceNode });
     if (cmd.run(-1) && cmd.exitCode() == 0) {
         QRegularExpression re(QStringLiteral("Cipher name:\\s+(\\w+)"));
@@ -682,6 +879,20 @@ void luks::initLUKS()
 
 void luks::setPayloadSize()
 {
+    if (mapperName().isEmpty())
+        return;
+
+    // sysfs reports the size of the active mapping in 512 byte sectors
+    QFile sizeFile(QStringLiteral("/sys/class/block/%1/size").arg(kernelName(mapperName())));
+    if (sizeFile.open(QIODevice::ReadOnly)) {
+        bool ok;
+        const qint64 sectors = sizeFile.readAll().trimmed().toLongLong(&ok);
+        if (ok) {
+            m_PayloadSize = sectors * 512;
+            return;
+        }
+    }
+
     ExternalCommand dmsetupCmd(QStringLiteral("dmsetup"), { QStringLiteral("table"), mapperName() });
     dmsetupCmd.run();
     QRegularExpression re(QStringLiteral("\\d+ (\\d+)"));
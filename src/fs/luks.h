@@ -28,6 +28,7 @@
 
 class Report;
 
+class QByteArray;
 class QString;
 class QWidget;
 
@@ -48,9 +49,23 @@ public:
         keyring
     };
 
+    /** Fields of a LUKS1 or LUKS2 header */
+    struct Header {
+        int version = 0;
+        qint64 sequenceId = 0;      /**< LUKS2 only, the higher of both header copies is current */
+        QString uuid;
+        QString label;              /**< LUKS2 only */
+        QString cipherName;
+        QString cipherMode;
+        QString hashName;
+        qint64 keySize = -1;        /**< volume key size in bits */
+        qint64 payloadOffset = -1;  /**< in bytes */
+    };
+
 public:
     void init() override;
     void scan(const QString& deviceNode) override;
+    void updateMinCapacity(const QString& deviceNode) override;
     qint64 readUsedCapacity(const QString& deviceNode) const override;
 
     CommandSupportType supportGetUsed() const override {
@@ -133,6 +148,7 @@ public:
     bool create(Report& report, const QString& deviceNode) override;
     SupportTool supportToolName() const override;
     bool supportToolFound() const override;
+    qint64 minCapacity() const override;
     QString readUUID(const QString& deviceNode) const override;
     bool updateUUID(Report& report, const QString& deviceNode) const override;
     bool resize(Report& report, const QString& deviceNode, qint64 length) const override;
@@ -185,6 +201,8 @@ public:
     qint64 payloadOffset() const { return m_PayloadOffset; }
 
     static bool canEncryptType(FileSystem::Type type);
+    static bool readHeader(const QString& deviceNode, Header& header);
+    static bool parseHeader(const QByteArray& data, Header& header);
     void initLUKS();
 
     bool testPassphrase(const QString& deviceNode, const QString& passphrase) const;
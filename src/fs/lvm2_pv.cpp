@@ -18,6 +18,7 @@
 
 #include "fs/lvm2_pv.h"
 #include "core/device.h"
+#include "core/lvmreport.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
@@ -230,6 +231,10 @@ void lvm2_pv::getPESize(const QString& deviceNode)
  */
 QString  lvm2_pv::getpvField(const QString& fieldName, const QString& deviceNode)
 {
+    QString value;
+    if (!deviceNode.isEmpty() && LvmReport::physicalVolumeField(deviceNode, fieldName, value))
+        return value;
+
     QStringList args = { QStringLiteral("pvs"),
                     QStringLiteral("--foreign"),
                     QStringLiteral("--readonly"),
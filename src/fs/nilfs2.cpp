@@ -17,6 +17,8 @@
  *************************************************************************/
 
 #include "fs/nilfs2.h"
+#include "fs/byteorder.h"
+#include "fs/superblockdecoder.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
@@ -33,6 +35,31 @@
 
 namespace FS
 {
+namespace
+{
+constexpr qint64 superblockOffset = 1024;
+constexpr quint16 nilfsMagic = 0x3434;
+
+qint64 usedCapacity(const QList<QByteArray>& data, const QString&)
+{
+    const QByteArray& superblock = data[0];
+    if (superblock.size() < 88 || le16(superblock, 6) != nilfsMagic)
+        return -1;
+
+    const quint32 logBlockSize = le32(superblock, 20);
+    if (logBlockSize > 6)
+        return -1;
+
+    const qint64 blockSize = 1024LL << logBlockSize;
+    const qint64 deviceSize = le64(superblock, 32);
+    const qint64 freeBlocks = le64(superblock, 80);
+    if (deviceSize <= 0 || freeBlocks < 0 || freeBlocks * blockSize > deviceSize)
+        return -1;
+
+    return deviceSize - blockSize * freeBlocks;
+}
+}
+
 FileSystem::CommandSupportType nilfs2::m_GetUsed = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType nilfs2::m_GetLabel = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType nilfs2::m_Create = FileSystem::cmdSupportNone;
@@ -61,7 +88,8 @@ void nilfs2::init()
     m_UpdateUUID = findExternal(QStringLiteral("nilfs-tune")) ? cmdSupportFileSystem : cmdSupportNone;
 
     m_Grow = findExternal(QStringLiteral("nilfs-resize")) ? cmdSupportFileSystem : cmdSupportNone;
-    m_GetUsed = findExternal(QStringLiteral("nilfs-tune")) ? cmdSupportFileSystem : cmdSupportNone;
+    SuperblockDecoder::registerDecoder(FileSystem::Type::Nilfs2, { { superblockOffset, 1024 } }, usedCapacity);
+    m_GetUsed = cmdSupportCore;
     m_Shrink = (m_Grow != cmdSupportNone && m_GetUsed != cmdSupportNone) ? cmdSupportFileSystem : cmdSupportNone;
 
     m_Copy =/* (m_Check != cmdSupportNone) ?*/ cmdSupportCore /*: cmdSupportNone*/;
@@ -123,6 +151,10 @@ bool nilfs2::create(Report& report, const QString& deviceNode)
 
 qint64 nilfs2::readUsedCapacity(const QString& deviceNode) const
 {
+    const qint64 used = SuperblockDecoder::readUsedCapacity(type(), deviceNode);
+    if (used >= 0)
+        return used;
+
     ExternalCommand cmd(QStringLiteral("nilfs-tune"), { QStringLiteral("-l"), deviceNode });
 
     if (cmd.run(-1) && cmd.exitCode() == 0) {
@@ -17,6 +17,7 @@
  *************************************************************************/
 
 #include "fs/ntfs.h"
+#include "fs/byteorder.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
@@ -29,12 +30,75 @@
 #include <QString>
 #include <QStringList>
 #include <QFile>
+#include <QtAlgorithms>
+#include <QtEndian>
 
 #include <algorithm>
 #include <ctime>
 
 namespace FS
 {
+namespace
+{
+constexpr quint32 bitmapRecord = 6;
+constexpr quint32 attributeData = 0x80;
+constexpr quint32 attributeEnd = 0xFFFFFFFF;
+
+// The bitmap is streamed in chunks; several chunks are requested with each helper call
+constexpr qint64 bitmapChunkSize = 4 * 1024 * 1024;
+constexpr int bitmapChunksPerRead = 4;
+
+/** Undoes the update sequence fixups of an MFT record */
+bool applyFixups(QByteArray& record)
+{
+    const int usaOffset = le16(record, 0x04);
+    const int usaCount = le16(record, 0x06);
+    if (usaCount < 2 || usaOffset + usaCount * 2 > record.size() || (usaCount - 1) * 512 > record.size())
+        return false;
+
+    for (int i = 1; i < usaCount; ++i) {
+        const int sectorEnd = i * 512 - 2;
+        if (record[sectorEnd] != record[usaOffset] || record[sectorEnd + 1] != record[usaOffset + 1])
+            return false;
+
+        record[sectorEnd] = record[usaOffset + i * 2];
+        record[sectorEnd + 1] = record[usaOffset + i * 2 + 1];
+    }
+
+    return true;
+}
+
+/** Decodes the mapping pairs of a non-resident attribute into (first cluster, cluster count) runs */
+bool decodeDataRuns(const QByteArray& record, int offset, int end, QList<QPair<qint64, qint64>>& runs)
+{
+    qint64 lcn = 0;
+    while (offset < end && record[offset] != 0) {
+        const int lengthSize = record[offset] & 0x0F;
+        const int offsetSize = (record[offset] >> 4) & 0x0F;
+        if (lengthSize == 0 || lengthSize > 8 || offsetSize == 0 || offsetSize > 8 || offset + 1 + lengthSize + offsetSize > end)
+            return false;
+
+        quint64 length = 0;
+        for (int i = lengthSize - 1; i >= 0; --i)
+            length = (length << 8) | static_cast<quint8>(record[offset + 1 + i]);
+
+        // Cluster offsets are signed and relative to the previous run
+        qint64 delta = static_cast<qint8>(record[offset + lengthSize + offsetSize]);
+        for (int i = offsetSize - 2; i >= 0; --i)
+            delta = delta * 256 + static_cast<quint8>(record[offset + 1 + lengthSize + i]);
+
+        lcn += delta;
+        if (lcn < 0)
+            return false;
+
+        runs.append(qMakePair(lcn, static_cast<qint64>(length)));
+        offset += 1 + lengthSize + offsetSize;
+    }
+
+    return true;
+}
+}
+
 FileSystem::CommandSupportType ntfs::m_GetUsed = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType ntfs::m_GetLabel = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType ntfs::m_Create = FileSystem::cmdSupportNone;
@@ -55,7 +119,8 @@ ntfs::ntfs(qint64 firstsector, qint64 lastsector, qint64 sectorsused, const QStr
 
 void ntfs::init()
 {
-    m_Shrink = m_Grow = m_Check = m_GetUsed = findExternal(QStringLiteral("ntfsresize")) ? cmdSupportFileSystem : cmdSupportNone;
+    m_Shrink = m_Grow = m_Check = findExternal(QStringLiteral("ntfsresize")) ? cmdSupportFileSystem : cmdSupportNone;
+    m_GetUsed = cmdSupportCore;
     m_GetLabel = cmdSupportCore;
     m_SetLabel = findExternal(QStringLiteral("ntfslabel")) ? cmdSupportFileSystem : cmdSupportNone;
     m_Create = findExternal(QStringLiteral("mkfs.ntfs")) ? cmdSupportFileSystem : cmdSupportNone;
@@ -90,7 +155,8 @@ FileSystem::SupportTool ntfs::supportToolName() const
 
 qint64 ntfs::minCapacity() const
 {
-    return 2 * Capacity::unitFactor(Capacity::Unit::Byte, Capacity::Unit::MiB);
+    const qint64 minimum = 2 * Capacity::unitFactor(Capacity::Unit::Byte, Capacity::Unit::MiB);
+    return std::max(minimum, m_MinimumSize);
 }
 
 qint64 ntfs::maxCapacity() const
@@ -103,7 +169,134 @@ int ntfs::maxLabelLength() const
     return 128;
 }
 
-qint64 ntfs::readUsedCapacity(const QString& deviceNode) const
+/** Counts allocated clusters in (a part of) the $Bitmap.
+    @param bitmap the bitmap data
+    @param bits number of bits at the start of @p bitmap to count
+    @return the number of set bits
+*/
+qint64 ntfs::countSetBits(const QByteArray& bitmap, qint64 bits)
+{
+    const uchar* p = reinterpret_cast<const uchar*>(bitmap.constData());
+    bits = std::min(bits, static_cast<qint64>(bitmap.size()) * 8);
+
+    qint64 count = 0;
+    const qint64 words = bits / 64;
+    for (qint64 i = 0; i < words; ++i)
+        count += qPopulationCount(qFromLittleEndian<quint64>(p + i * 8));
+
+    for (qint64 i = words * 64; i < bits; ++i)
+        count += (p[i / 8] >> (i % 8)) & 1;
+
+    return count;
+}
+
+/** Reads the cluster allocation from the $Bitmap system file.
+
+    The boot sector gives the location of the MFT. The $DATA attribute of MFT record 6
+    describes where $Bitmap is stored; its runs are then read and their set bits counted.
+
+    @param deviceNode the device node of the file system
+    @param usage receives the cluster size and counts
+    @return true if the allocation could be determined
+*/
+bool ntfs::readUsage(const QString& deviceNode, Usage& usage)
+{
+    QByteArray bootSector;
+    if (!ExternalCommand::readData(deviceNode, 0, 512, bootSector) || bootSector.mid(3, 8) != QByteArrayLiteral("NTFS    "))
+        return false;
+
+    const qint64 bytesPerSector = le16(bootSector, 0x0B);
+    const quint8 sectorsPerClusterValue = bootSector[0x0D];
+    const qint64 sectorsPerCluster = sectorsPerClusterValue > 0x80 ? 1LL << (256 - sectorsPerClusterValue) : sectorsPerClusterValue;
+    const qint64 totalSectors = le64(bootSector, 0x28);
+    const qint64 mftCluster = le64(bootSector, 0x30);
+    const qint8 recordSizeValue = bootSector[0x40];
+
+    if (bytesPerSector < 256 || bytesPerSector > 4096 || sectorsPerCluster == 0 || totalSectors <= 0 || mftCluster <= 0)
+        return false;
+
+    usage.clusterSize = bytesPerSector * sectorsPerCluster;
+    usage.clusterCount = totalSectors / sectorsPerCluster;
+    usage.usedClusters = 0;
+
+    const qint64 recordSize = recordSizeValue > 0 ? recordSizeValue * usage.clusterSize : 1LL << -recordSizeValue;
+    if (recordSize < 512 || recordSize > 65536)
+        return false;
+
+    QByteArray record;
+    if (!ExternalCommand::readData(deviceNode, mftCluster * usage.clusterSize + bitmapRecord * recordSize, recordSize, record) ||
+        !record.startsWith("FILE") || !applyFixups(record))
+        return false;
+
+    // Find the unnamed $DATA attribute
+    int offset = le16(record, 0x14);
+    while (offset + 16 <= record.size() && le32(record, offset) != attributeEnd) {
+        const quint32 type = le32(record, offset);
+        const int length = le32(record, offset + 4);
+        if (length < 16 || offset + length > record.size())
+            return false;
+
+        if (type == attributeData && record[offset + 9] == 0) {
+            // Tiny volumes can have the bitmap stored in the MFT record itself
+            if (record[offset + 8] == 0) {
+                const int valueLength = le32(record, offset + 0x10);
+                const int valueOffset = le16(record, offset + 0x14);
+                if (valueOffset + valueLength > length)
+                    return false;
+                usage.usedClusters = countSetBits(record.mid(offset + valueOffset, valueLength), usage.clusterCount);
+                return true;
+            }
+
+            if (length < 0x40 || le64(record, offset + 0x10) != 0)
+                return false;
+
+            QList<QPair<qint64, qint64>> runs;
+            if (!decodeDataRuns(record, offset + le16(record, offset + 0x20), offset + length, runs))
+                return false;
+
+            // Split the runs into chunks, dropping the padding behind the last cluster
+            QList<QPair<qint64, qint64>> chunks;
+            qint64 remainingBytes = (usage.clusterCount + 7) / 8;
+            for (const auto& run : qAsConst(runs)) {
+                const qint64 runBytes = std::min(run.second * usage.clusterSize, remainingBytes);
+                for (qint64 chunkOffset = 0; chunkOffset < runBytes; chunkOffset += bitmapChunkSize)
+                    chunks.append(qMakePair(run.first * usage.clusterSize + chunkOffset, std::min(bitmapChunkSize, runBytes - chunkOffset)));
+                remainingBytes -= runBytes;
+            }
+            if (remainingBytes > 0)
+                return false;
+
+            qint64 remainingBits = usage.clusterCount;
+            for (int first = 0; first < chunks.size(); first += bitmapChunksPerRead) {
+                const QList<QPair<qint64, qint64>> ranges = chunks.mid(first, bitmapChunksPerRead);
+                const QList<QByteArray> data = ExternalCommand::readData(deviceNode, ranges);
+                if (data.size() != ranges.size())
+                    return false;
+
+                for (int i = 0; i < data.size(); ++i) {
+                    if (data[i].size() != ranges[i].second)
+                        return false;
+
+                    const qint64 bits = std::min(remainingBits, static_cast<qint64>(data[i].size()) * 8);
+                    usage.usedClusters += countSetBits(data[i], bits);
+                    remainingBits -= bits;
+                }
+            }
+
+            return true;
+        }
+
+        offset += length;
+    }
+
+    return false;
+}
+
+/** Asks ntfsresize for the smallest size the file system can be shrunk to.
+    @param deviceNode the device node of the file system
+    @return the size in bytes or -1 on failure
+*/
+qint64 ntfs::readMinimumSize(const QString& deviceNode)
 {
     ExternalCommand cmd(QStringLiteral("ntfsresize"), { QStringLiteral("--info"), QStringLiteral("--force"), QStringLiteral("--no-progress-bar"), deviceNode });
 
@@ -122,6 +315,26 @@ qint64 ntfs::readUsedCapacity(const QString& deviceNode) const
     return -1;
 }
 
+/** Asks ntfsresize how far the file system can be shrunk, which minCapacity() reports afterwards.
+    How far depends on where its data is placed, so ntfsresize is asked once, when the first
+    resize is planned.
+    @param deviceNode the device node of the file system
+*/
+void ntfs::updateMinCapacity(const QString& deviceNode)
+{
+    if (m_MinimumSize < 0 && m_Shrink != cmdSupportNone)
+        m_MinimumSize = std::max(readMinimumSize(deviceNode), 0LL);
+}
+
+qint64 ntfs::readUsedCapacity(const QString& deviceNode) const
+{
+    Usage usage;
+    if (readUsage(deviceNode, usage))
+        return usage.usedClusters * usage.clusterSize;
+
+    return m_Shrink != cmdSupportNone ? readMinimumSize(deviceNode) : -1;
+}
+
 bool ntfs::writeLabel(Report& report, const QString& deviceNode, const QString& newLabel)
 {
     ExternalCommand writeCmd(report, QStringLiteral("ntfslabel"), { QStringLiteral("--force"), deviceNode, newLabel }, QProcess::SeparateChannels);
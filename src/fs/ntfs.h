@@ -23,11 +23,12 @@
 
 #include "fs/filesystem.h"
 
+#include <QString>
 #include <QtGlobal>
 
 class Report;
 
-class QString;
+class QByteArray;
 
 namespace FS
 {
@@ -36,12 +37,21 @@ namespace FS
  */
 class LIBKPMCORE_EXPORT ntfs : public FileSystem
 {
+public:
+    /** Cluster allocation of an NTFS file system */
+    struct Usage {
+        qint64 clusterSize = 0;
+        qint64 clusterCount = 0;
+        qint64 usedClusters = 0;
+    };
+
 public:
     ntfs(qint64 firstsector, qint64 lastsector, qint64 sectorsused, const QString& label, const QVariantMap& features = {});
 
 public:
     void init() override;
 
+    void updateMinCapacity(const QString& deviceNode) override;
     qint64 readUsedCapacity(const QString& deviceNode) const override;
     bool check(Report& report, const QString& deviceNode) const override;
     bool create(Report& report, const QString& deviceNode) override;
@@ -94,6 +104,10 @@ public:
     SupportTool supportToolName() const override;
     bool supportToolFound() const override;
 
+    static bool readUsage(const QString& deviceNode, Usage& usage);
+    static qint64 countSetBits(const QByteArray& bitmap, qint64 bits);
+    static qint64 readMinimumSize(const QString& deviceNode);
+
 public:
     static CommandSupportType m_GetUsed;
     static CommandSupportType m_GetLabel;
@@ -107,6 +121,9 @@ public:
     static CommandSupportType m_SetLabel;
     static CommandSupportType m_UpdateUUID;
     static CommandSupportType m_GetUUID;
+
+private:
+    qint64 m_MinimumSize = -1;
 };
 }
 
@@ -17,15 +17,61 @@
  *************************************************************************/
 
 #include "fs/reiser4.h"
+#include "fs/superblockdecoder.h"
 
 #include "util/capacity.h"
 #include "util/externalcommand.h"
 
 #include <QRegularExpression>
 #include <QStringList>
+#include <QtEndian>
 
 namespace FS
 {
+namespace
+{
+// The master superblock is followed by the format40 superblock in the next block
+constexpr qint64 masterOffset = 64 * 1024;
+constexpr qint64 defaultBlockSize = 4096;
+
+quint16 le16(const QByteArray& data, int offset)
+{
+    return qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(data.constData() + offset));
+}
+
+quint64 le64(const QByteArray& data, int offset)
+{
+    return qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(data.constData() + offset));
+}
+
+qint64 usedCapacity(const QList<QByteArray>& data, const QString& deviceNode)
+{
+    const QByteArray& master = data[0];
+    if (master.size() < 64 || !master.startsWith("ReIsEr4"))
+        return -1;
+
+    const qint64 blockSize = le16(master, 18);
+    if (blockSize < 512 || (blockSize & (blockSize - 1)))
+        return -1;
+
+    // Only block sizes above 4 KiB need a second read
+    const qint64 formatOffset = (masterOffset / blockSize + 1) * blockSize;
+    QByteArray format = master.mid(formatOffset - masterOffset, 512);
+    if (format.size() < 512 && !ExternalCommand::readData(deviceNode, formatOffset, 512, format))
+        return -1;
+
+    if (!format.mid(52, 16).startsWith("ReIsEr40FoRmAt"))
+        return -1;
+
+    const qint64 blocks = le64(format, 0);
+    const qint64 freeBlocks = le64(format, 8);
+    if (freeBlocks < 0 || freeBlocks > blocks)
+        return -1;
+
+    return (blocks - freeBlocks) * blockSize;
+}
+}
+
 FileSystem::CommandSupportType reiser4::m_GetUsed = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType reiser4::m_GetLabel = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType reiser4::m_Create = FileSystem::cmdSupportNone;
@@ -42,7 +88,8 @@ reiser4::reiser4(qint64 firstsector, qint64 lastsector, qint64 sectorsused, cons
 void reiser4::init()
 {
     m_GetLabel = cmdSupportCore;
-    m_GetUsed = findExternal(QStringLiteral("debugfs.reiser4"), {}, 16) ? cmdSupportFileSystem : cmdSupportNone;
+    SuperblockDecoder::registerDecoder(FileSystem::Type::Reiser4, { { masterOffset, 2 * defaultBlockSize } }, usedCapacity);
+    m_GetUsed = cmdSupportCore;
     m_Create = findExternal(QStringLiteral("mkfs.reiser4"), {}, 16) ? cmdSupportFileSystem : cmdSupportNone;
     m_Check = findExternal(QStringLiteral("fsck.reiser4"), {}, 16) ? cmdSupportFileSystem : cmdSupportNone;
     m_Move = m_Copy = (m_Check != cmdSupportNone) ? cmdSupportCore : cmdSupportNone;
@@ -85,6 +132,10 @@ int reiser4::maxLabelLength() const
 
 qint64 reiser4::readUsedCapacity(const QString& deviceNode) const
 {
+    const qint64 used = SuperblockDecoder::readUsedCapacity(type(), deviceNode);
+    if (used >= 0)
+        return used;
+
     ExternalCommand cmd(QStringLiteral("debugfs.reiser4"), { deviceNode });
 
     if (cmd.run(-1) && cmd.exitCode() == 16) {
@@ -17,6 +17,8 @@
  *************************************************************************/
 
 #include "fs/reiserfs.h"
+#include "fs/byteorder.h"
+#include "fs/superblockdecoder.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
@@ -28,6 +30,31 @@
 
 namespace FS
 {
+namespace
+{
+constexpr qint64 superblockOffset = 64 * 1024;
+
+qint64 usedCapacity(const QList<QByteArray>& data, const QString&)
+{
+    const QByteArray& superblock = data[0];
+    if (superblock.size() < 64)
+        return -1;
+
+    // "ReIsErFs", "ReIsEr2Fs" or "ReIsEr3Fs"
+    const QByteArray magic = superblock.mid(52, 10);
+    if (!magic.startsWith("ReIsEr") || !magic.contains("Fs"))
+        return -1;
+
+    const qint64 blockCount = le32(superblock, 0);
+    const qint64 freeBlocks = le32(superblock, 4);
+    const qint64 blockSize = le16(superblock, 44);
+    if (blockSize < 512 || freeBlocks > blockCount)
+        return -1;
+
+    return (blockCount - freeBlocks) * blockSize;
+}
+}
+
 FileSystem::CommandSupportType reiserfs::m_GetUsed = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType reiserfs::m_GetLabel = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType reiserfs::m_Create = FileSystem::cmdSupportNone;
@@ -49,7 +76,8 @@ reiserfs::reiserfs(qint64 firstsector, qint64 lastsector, qint64 sectorsused, co
 void reiserfs::init()
 {
     m_GetLabel = cmdSupportCore;
-    m_GetUsed = findExternal(QStringLiteral("debugreiserfs"), {}, 16) ? cmdSupportFileSystem : cmdSupportNone;
+    SuperblockDecoder::registerDecoder(FileSystem::Type::ReiserFS, { { superblockOffset, 512 } }, usedCapacity);
+    m_GetUsed = cmdSupportCore;
     m_SetLabel = findExternal(QStringLiteral("reiserfstune")) ? cmdSupportFileSystem : cmdSupportNone;
     m_Create = findExternal(QStringLiteral("mkfs.reiserfs")) ? cmdSupportFileSystem : cmdSupportNone;
     m_Check = findExternal(QStringLiteral("fsck.reiserfs")) ? cmdSupportFileSystem : cmdSupportNone;
@@ -100,6 +128,10 @@ int reiserfs::maxLabelLength() const
 
 qint64 reiserfs::readUsedCapacity(const QString& deviceNode) const
 {
+    const qint64 used = SuperblockDecoder::readUsedCapacity(type(), deviceNode);
+    if (used >= 0)
+        return used;
+
     ExternalCommand cmd(QStringLiteral("debugreiserfs"), { deviceNode });
 
     if (cmd.run(-1) && cmd.exitCode() == 16) {
@@ -0,0 +1,73 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#include "fs/superblockdecoder.h"
+
+#include "util/externalcommand.h"
+
+#include <QMap>
+#include <QString>
+
+namespace
+{
+struct Decoder
+{
+    SuperblockDecoder::Ranges ranges;
+    SuperblockDecoder::UsedCapacity usedCapacity;
+};
+
+// Decoders are registered from FileSystem::init() and only read afterwards
+QMap<FileSystem::Type, Decoder>& decoders()
+{
+    static QMap<FileSystem::Type, Decoder> map;
+    return map;
+}
+}
+
+/** Registers the decoder for a file system type, replacing an earlier one.
+    @param type the file system type
+    @param ranges the byte ranges the decoder needs
+    @param usedCapacity computes the used capacity from the data of @p ranges
+*/
+void SuperblockDecoder::registerDecoder(FileSystem::Type type, const Ranges& ranges, const UsedCapacity& usedCapacity)
+{
+    decoders().insert(type, { ranges, usedCapacity });
+}
+
+/** @return true if a decoder for @p type has been registered */
+bool SuperblockDecoder::isRegistered(FileSystem::Type type)
+{
+    return decoders().contains(type);
+}
+
+/** Reads the used capacity of a file system with its registered decoder.
+    @param type the file system type
+    @param deviceNode the device node of the file system
+    @return the used capacity in bytes, -1 if there is no decoder or decoding failed
+*/
+qint64 SuperblockDecoder::readUsedCapacity(FileSystem::Type type, const QString& deviceNode)
+{
+    const auto it = decoders().constFind(type);
+    if (it == decoders().constEnd())
+        return -1;
+
+    const QList<QByteArray> data = ExternalCommand::readData(deviceNode, it->ranges);
+    if (data.size() != it->ranges.size())
+        return -1;
+
+    return it->usedCapacity(data, deviceNode);
+}
@@ -0,0 +1,61 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#if !defined(KPMCORE_SUPERBLOCKDECODER_H)
+
+#define KPMCORE_SUPERBLOCKDECODER_H
+
+#include "fs/filesystem.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QtGlobal>
+
+#include <functional>
+
+class QString;
+
+/** Registry of native decoders for the used capacity of file systems.
+
+    A file system registers the byte ranges of a partition its decoder needs, usually
+    the superblock and other structures at fixed offsets, together with a function
+    computing the used capacity from them. All ranges of a decoder are read with a
+    single helper call, so no external tool has to be run.
+*/
+class SuperblockDecoder
+{
+public:
+    /** byte ranges to read, as pairs of offset and size */
+    typedef QList<QPair<qint64, qint64>> Ranges;
+
+    /** computes the used capacity in bytes from the data read for the ranges, in the same order.
+        Ranges that could not be read are empty. File systems that keep their counters at a
+        location stored in the superblock may read more from the device node.
+        @return the used capacity or -1 if the data does not hold a valid file system */
+    typedef std::function<qint64(const QList<QByteArray>& data, const QString& deviceNode)> UsedCapacity;
+
+private:
+    SuperblockDecoder();
+
+public:
+    static void registerDecoder(FileSystem::Type type, const Ranges& ranges, const UsedCapacity& usedCapacity);
+    static bool isRegistered(FileSystem::Type type);
+    static qint64 readUsedCapacity(FileSystem::Type type, const QString& deviceNode);
+};
+
+#endif
@@ -16,6 +16,8 @@
  *************************************************************************/
 
 #include "fs/udf.h"
+#include "fs/byteorder.h"
+#include "fs/superblockdecoder.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
@@ -28,11 +30,110 @@
 #include <QString>
 #include <QStringList>
 
+#include <algorithm>
+
 namespace FS
 {
 constexpr qint64 MIN_UDF_BLOCKS = 300;
 constexpr qint64 MAX_UDF_BLOCKS = ((1ULL << 32) - 1);
 
+namespace
+{
+// The anchor volume descriptor pointer is in sector 256, for any of these sector sizes
+constexpr qint64 sectorSizes[] = { 512, 1024, 2048, 4096 };
+constexpr qint64 anchorSector = 256;
+constexpr qint64 maxSequenceSize = 64 * 1024;
+
+constexpr quint16 tagAnchor = 2;
+constexpr quint16 tagLogicalVolume = 6;
+constexpr quint16 tagTerminating = 8;
+constexpr quint16 tagIntegrity = 9;
+
+/** @return the identifier of the descriptor tag at @p offset, 0 if its checksum is wrong */
+quint16 tagIdentifier(const QByteArray& data, int offset)
+{
+    if (data.size() < offset + 16)
+        return 0;
+
+    quint8 sum = 0;
+    for (int i = 0; i < 16; ++i)
+        if (i != 4)
+            sum += static_cast<quint8>(data[offset + i]);
+
+    return sum == static_cast<quint8>(data[offset + 4]) ? le16(data, offset) : 0;
+}
+
+/** Reads a descriptor sequence given by an extent (length in bytes and location in sectors) */
+QByteArray readSequence(const QString& deviceNode, const QByteArray& extent, int offset, qint64 sectorSize)
+{
+    const qint64 length = std::min(static_cast<qint64>(le32(extent, offset)), maxSequenceSize);
+    const qint64 location = le32(extent, offset + 4);
+    QByteArray sequence;
+    if (length < sectorSize || location == 0)
+        return sequence;
+
+    ExternalCommand::readData(deviceNode, location * sectorSize, length - length % sectorSize, sequence);
+    return sequence;
+}
+
+/** Free and total blocks of each partition are kept in the logical volume integrity
+    descriptor, which is found through the anchor and the logical volume descriptor */
+qint64 usedCapacity(const QList<QByteArray>& data, const QString& deviceNode)
+{
+    qint64 sectorSize = 0;
+    QByteArray anchor;
+    for (int i = 0; i < data.size() && sectorSize == 0; ++i) {
+        if (tagIdentifier(data[i], 0) == tagAnchor && le32(data[i], 12) == anchorSector) {
+            sectorSize = sectorSizes[i];
+            anchor = data[i];
+        }
+    }
+    if (sectorSize == 0)
+        return -1;
+
+    // Main volume descriptor sequence
+    const QByteArray volume = readSequence(deviceNode, anchor, 16, sectorSize);
+    QByteArray logicalVolume;
+    for (int offset = 0; offset + sectorSize <= volume.size(); offset += sectorSize) {
+        const quint16 tag = tagIdentifier(volume, offset);
+        if (tag == tagLogicalVolume)
+            logicalVolume = volume.mid(offset, sectorSize);
+        else if (tag == tagTerminating)
+            break;
+    }
+    if (logicalVolume.size() < 440)
+        return -1;
+
+    const qint64 blockSize = le32(logicalVolume, 212);
+    const QByteArray integrity = readSequence(deviceNode, logicalVolume, 432, sectorSize);
+    QByteArray integrityDescriptor;
+    for (int offset = 0; offset + sectorSize <= integrity.size(); offset += sectorSize) {
+        const quint16 tag = tagIdentifier(integrity, offset);
+        if (tag == tagIntegrity)
+            integrityDescriptor = integrity.mid(offset, sectorSize);
+        else if (tag == tagTerminating)
+            break;
+    }
+    if (integrityDescriptor.size() < 80 || blockSize <= 0)
+        return -1;
+
+    // Free space table followed by the size table, one entry per partition
+    const qint64 partitions = le32(integrityDescriptor, 72);
+    if (partitions <= 0 || 80 + partitions * 8 > integrityDescriptor.size())
+        return -1;
+
+    qint64 usedBlocks = 0;
+    for (int i = 0; i < partitions; ++i) {
+        const quint32 freeBlocks = le32(integrityDescriptor, 80 + i * 4);
+        const quint32 size = le32(integrityDescriptor, 80 + (partitions + i) * 4);
+        if (freeBlocks != 0xffffffff && freeBlocks <= size)
+            usedBlocks += size - freeBlocks;
+    }
+
+    return usedBlocks * blockSize;
+}
+}
+
 FileSystem::CommandSupportType udf::m_GetUsed = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType udf::m_SetLabel = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType udf::m_UpdateUUID = FileSystem::cmdSupportNone;
@@ -46,14 +147,19 @@ udf::udf(qint64 firstsector, qint64 lastsector, qint64 sectorsused, const QStrin
 
 void udf::init()
 {
-    m_GetUsed = findExternal(QStringLiteral("udfinfo"), {}, 1) ? cmdSupportFileSystem : cmdSupportNone;
+    SuperblockDecoder::Ranges anchors;
+    for (qint64 sectorSize : sectorSizes)
+        anchors.append(qMakePair(anchorSector * sectorSize, 512LL));
+    SuperblockDecoder::registerDecoder(FileSystem::Type::Udf, anchors, usedCapacity);
+    m_GetUsed = cmdSupportCore;
     m_SetLabel = m_UpdateUUID = findExternal(QStringLiteral("udflabel"), {}, 1) ? cmdSupportFileSystem : cmdSupportNone;
     m_Create = findExternal(QStringLiteral("mkudffs"), {}, 1) ? cmdSupportFileSystem : cmdSupportNone;
 
     if (m_Create == cmdSupportFileSystem) {
         // Detect old mkudffs prior to version 1.1 by lack of --label option
-        ExternalCommand cmd(QStringLiteral("mkudffs"), { QStringLiteral("--help") });
-        oldMkudffsVersion = cmd.run(-1) && !cmd.output().contains(QStringLiteral("--label"));
+        int exitCode;
+        QString output;
+        oldMkudffsVersion = probeExternal(QStringLiteral("mkudffs"), { QStringLiteral("--help") }, exitCode, output) && !output.contains(QStringLiteral("--label"));
     }
 }
 
@@ -104,6 +210,10 @@ QValidator* udf::labelValidator(QObject *parent) const
 
 qint64 udf::readUsedCapacity(const QString& deviceNode) const
 {
+    const qint64 used = SuperblockDecoder::readUsedCapacity(type(), deviceNode);
+    if (used >= 0)
+        return used;
+
     ExternalCommand cmd(QStringLiteral("udfinfo"), { QStringLiteral("--utf8"), deviceNode });
     if (!cmd.run(-1) || cmd.exitCode() != 0)
         return -1;
@@ -17,6 +17,7 @@
  *************************************************************************/
 
 #include "fs/xfs.h"
+#include "fs/byteorder.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
@@ -31,6 +32,21 @@
 
 namespace FS
 {
+namespace
+{
+constexpr quint32 superblockMagic = 0x58465342; // "XFSB"
+constexpr quint32 agfMagic = 0x58414746;        // "XAGF"
+constexpr int superblockSize = 512;
+constexpr quint16 versionNumberMask = 0x000F;
+constexpr quint16 versionMoreBits = 0x8000;
+constexpr quint32 features2LazyCount = 0x0002;
+
+bool isPowerOfTwo(qint64 value)
+{
+    return value > 0 && (value & (value - 1)) == 0;
+}
+}
+
 FileSystem::CommandSupportType xfs::m_GetUsed = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType xfs::m_GetLabel = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType xfs::m_Create = FileSystem::cmdSupportNone;
@@ -49,7 +65,8 @@ xfs::xfs(qint64 firstsector, qint64 lastsector, qint64 sectorsused, const QStrin
 void xfs::init()
 {
     m_GetLabel = cmdSupportCore;
-    m_SetLabel = m_GetUsed = findExternal(QStringLiteral("xfs_db")) ? cmdSupportFileSystem : cmdSupportNone;
+    m_SetLabel = findExternal(QStringLiteral("xfs_db")) ? cmdSupportFileSystem : cmdSupportNone;
+    m_GetUsed = cmdSupportCore;
     m_Create = findExternal(QStringLiteral("mkfs.xfs")) ? cmdSupportFileSystem : cmdSupportNone;
 
     m_Check = findExternal(QStringLiteral("xfs_repair")) ? cmdSupportFileSystem : cmdSupportNone;
@@ -96,8 +113,97 @@ int xfs::maxLabelLength() const
     return 12;
 }
 
+/** Decodes the primary XFS superblock.
+    @param data the first sector of the file system
+    @param superblock receives the superblock fields
+    @return true if the data is a valid superblock
+*/
+bool xfs::parseSuperblock(const QByteArray& data, Superblock& superblock)
+{
+    if (data.size() < superblockSize || be32(data, 0x00) != superblockMagic)
+        return false;
+
+    superblock.blockSize = be32(data, 0x04);
+    superblock.dataBlocks = be64(data, 0x08);
+    superblock.agBlocks = be32(data, 0x54);
+    superblock.agCount = be32(data, 0x58);
+    superblock.sectorSize = be16(data, 0x66);
+    superblock.freeDataBlocks = be64(data, 0x90);
+
+    if (!isPowerOfTwo(superblock.blockSize) || superblock.blockSize < 512 || superblock.blockSize > 65536 ||
+        !isPowerOfTwo(superblock.sectorSize) || superblock.sectorSize < 512 || superblock.sectorSize > 32768 ||
+        superblock.agBlocks == 0 || superblock.agCount == 0 || superblock.freeDataBlocks > superblock.dataBlocks)
+        return false;
+
+    // Version 5 file systems always use lazy counters
+    const quint16 versionNumber = be16(data, 0x64);
+    superblock.lazyCounters = (versionNumber & versionNumberMask) >= 5 ||
+        ((versionNumber & versionMoreBits) && (be32(data, 0xC8) & features2LazyCount));
+
+    superblock.uuid = uuidToString(data, 0x20);
+
+    QByteArray label = data.mid(0x6C, 12);
+    if (label.indexOf('\0') >= 0)
+        label.truncate(label.indexOf('\0'));
+    superblock.label = QString::fromUtf8(label);
+
+    return true;
+}
+
+/** Reads the primary superblock of an XFS file system.
+
+    With lazy counters the free block count in the superblock is only up to date after
+    a clean unmount. If @p sumAllocationGroups is set, the free counts of all allocation
+    group headers (AGF) are read with a single helper call and summed instead.
+
+    @param deviceNode the device node of the file system
+    @param superblock receives the superblock fields
+    @param sumAllocationGroups sum the AGF free counts if the file system uses lazy counters
+    @return true if a valid superblock was found
+*/
+bool xfs::readSuperblock(const QString& deviceNode, Superblock& superblock, bool sumAllocationGroups)
+{
+    QByteArray data;
+    if (!ExternalCommand::readData(deviceNode, 0, superblockSize, data) || !parseSuperblock(data, superblock))
+        return false;
+
+    if (!sumAllocationGroups || !superblock.lazyCounters)
+        return true;
+
+    // The AGF is in the second sector of each allocation group
+    QList<QPair<qint64, qint64>> ranges;
+    for (qint64 ag = 0; ag < superblock.agCount; ++ag)
+        ranges.append(qMakePair(ag * superblock.agBlocks * superblock.blockSize + superblock.sectorSize, superblock.sectorSize));
+
+    const QList<QByteArray> agfs = ExternalCommand::readData(deviceNode, ranges);
+    if (agfs.size() != ranges.size())
+        return true;
+
+    qint64 freeBlocks = 0;
+    for (qint64 ag = 0; ag < superblock.agCount; ++ag) {
+        const QByteArray& agf = agfs[ag];
+        if (agf.size() < 0x40 || be32(agf, 0x00) != agfMagic || static_cast<qint64>(be32(agf, 0x08)) != ag)
+            return true;
+
+        // Free extents, blocks on the free list and blocks used by the free space btrees
+        freeBlocks += be32(agf, 0x34) + static_cast<qint64>(be32(agf, 0x30)) + be32(agf, 0x3C);
+    }
+
+    if (freeBlocks <= superblock.dataBlocks)
+        superblock.freeDataBlocks = freeBlocks;
+
+    return true;
+}
+
 qint64 xfs::readUsedCapacity(const QString& deviceNode) const
 {
+    Superblock superblock;
+    if (readSuperblock(deviceNode, superblock, true))
+        return (superblock.dataBlocks - superblock.freeDataBlocks) * superblock.blockSize;
+
+    if (!findExternal(QStringLiteral("xfs_db")))
+        return -1;
+
     ExternalCommand cmd(QStringLiteral("xfs_db"), { QStringLiteral("-c"), QStringLiteral("sb 0"), QStringLiteral("-c"), QStringLiteral("print"), deviceNode });
 
     if (cmd.run(-1) && cmd.exitCode() == 0) {
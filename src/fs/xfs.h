@@ -23,11 +23,12 @@
 
 #include "fs/filesystem.h"
 
+#include <QString>
 #include <QtGlobal>
 
 class Report;
 
-class QString;
+class QByteArray;
 
 namespace FS
 {
@@ -36,6 +37,20 @@ namespace FS
 */
 class LIBKPMCORE_EXPORT xfs : public FileSystem
 {
+public:
+    /** Fields of the primary XFS superblock */
+    struct Superblock {
+        qint64 blockSize = 0;
+        qint64 sectorSize = 0;
+        qint64 dataBlocks = 0;
+        qint64 freeDataBlocks = 0;
+        qint64 agBlocks = 0;
+        qint64 agCount = 0;
+        bool lazyCounters = false;  /**< free counts are only written back on clean unmount */
+        QString label;
+        QString uuid;
+    };
+
 public:
     xfs(qint64 firstsector, qint64 lastsector, qint64 sectorsused, const QString& label, const QVariantMap& features = {});
 
@@ -87,6 +102,9 @@ public:
     SupportTool supportToolName() const override;
     bool supportToolFound() const override;
 
+    static bool readSuperblock(const QString& deviceNode, Superblock& superblock, bool sumAllocationGroups = false);
+    static bool parseSuperblock(const QByteArray& data, Superblock& superblock);
+
 public:
     static CommandSupportType m_GetUsed;
     static CommandSupportType m_GetLabel;
@@ -20,9 +20,13 @@
 
 #include "plugins/sfdisk/sfdiskbackend.h"
 #include "plugins/sfdisk/sfdiskdevice.h"
+#include "plugins/sfdisk/sfdiskprobecache.h"
+#include "plugins/sfdisk/sfdiskscancache.h"
+#include "plugins/sfdisk/sfdisktablereader.h"
 
 #include "core/copysourcedevice.h"
 #include "core/copytargetbytearray.h"
+#include "core/devicefilter.h"
 #include "core/diskdevice.h"
 #include "core/lvmdevice.h"
 #include "core/partitiontable.h"
@@ -30,6 +34,7 @@
 #include "core/raid/softwareraid.h"
 
 #include "fs/filesystemfactory.h"
+#include "fs/filesystemtypes.h"
 #include "fs/luks.h"
 #include "fs/luks2.h"
 
@@ -39,7 +44,9 @@
 
 #include <QDataStream>
 #include <QDebug>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -53,6 +60,22 @@
 
 K_PLUGIN_FACTORY_WITH_JSON(SfdiskBackendFactory, "pmsfdiskbackendplugin.json", registerPlugin<SfdiskBackend>();)
 
+/** @return the partition nodes of the given disks according to sysfs */
+static QStringList partitionNodes(const QStringList& deviceNodes)
+{
+    QStringList nodes;
+    for (const QString& deviceNode : deviceNodes) {
+        const QString name = QFileInfo(QFileInfo(deviceNode).canonicalFilePath()).fileName();
+        const QString sysfsPath = QStringLiteral("/sys/class/block/") + name;
+        const QStringList entries = QDir(sysfsPath).entryList({ name + QLatin1Char('*') }, QDir::Dirs | QDir::NoDotAndDotDot);
+        for (const QString& entry : entries)
+            if (QFile::exists(sysfsPath + QLatin1Char('/') + entry + QStringLiteral("/partition")))
+                nodes.append(QStringLiteral("/dev/") + entry);
+    }
+
+    return nodes;
+}
+
 SfdiskBackend::SfdiskBackend(QObject*, const QList<QVariant>&) :
     CoreBackend()
 {
@@ -68,6 +91,11 @@ QList<Device*> SfdiskBackend::scanDevices(bool excludeReadOnly)
 }
 
 QList<Device*> SfdiskBackend::scanDevices(const ScanFlags scanFlags)
+{
+    return scanDevices(DeviceFilter(), scanFlags);
+}
+
+QList<Device*> SfdiskBackend::scanDevices(const DeviceFilter& filter, const ScanFlags scanFlags)
 {
     const bool includeReadOnly = scanFlags.testFlag(ScanFlag::includeReadOnly);
     const bool includeLoopback = scanFlags.testFlag(ScanFlag::includeLoopback);
@@ -75,19 +103,46 @@ QList<Device*> SfdiskBackend::scanDevices(const ScanFlags scanFlags)
     QList<Device*> result;
     QStringList deviceNodes;
 
+    SfdiskProbeCache::clear();
+    SfdiskScanCache::resetStatistics();
+
+    // Collect the whole device inventory with a single lsblk call, which like the udev
+    // database runs without the helper. Nested scans, e.g. of a volume group from
+    // scanDevice(), keep the inventory of the outer one.
+    const bool ownsInventory = m_Inventory.isEmpty();
+    QJsonArray jsonArray;
+    bool haveDevices = false;
+
     ExternalCommand cmd(QStringLiteral("lsblk"),
                         { QStringLiteral("--nodeps"),
                           QStringLiteral("--paths"),
+                          QStringLiteral("--bytes"),
                           QStringLiteral("--sort"), QStringLiteral("name"),
                           QStringLiteral("--json"),
                           QStringLiteral("--output"),
-                          QStringLiteral("type,name") });
+                          QStringLiteral("type,name,kname,size,log-sec,model,tran") });
 
     if (cmd.run(-1) && cmd.exitCode() == 0) {
         const QJsonDocument jsonDocument = QJsonDocument::fromJson(cmd.rawOutput());
-        const QJsonObject jsonObject = jsonDocument.object();
-        const QJsonArray jsonArray = jsonObject[QLatin1String("blockdevices")].toArray();
-        for (const auto &deviceLine : jsonArray) {
+        jsonArray = jsonDocument.object()[QLatin1String("blockdevices")].toArray();
+        haveDevices = true;
+
+        if (ownsInventory) {
+            for (const auto &deviceLine : qAsConst(jsonArray)) {
+                const QJsonObject deviceObject = deviceLine.toObject();
+                m_Inventory.insert(deviceObject[QLatin1String("name")].toString(), deviceObject);
+            }
+        }
+    }
+
+    // Volume manager members found on disks and the devices assembled afterwards share one LVM and RAID snapshot
+    VolumeManagerDevice::beginScan();
+
+    // Disks holding members of requested LVM volume groups and RAID arrays are always scanned
+    const QStringList memberDisks = filter.matchesAll() ? QStringList() : VolumeManagerDevice::memberDisks(filter);
+
+    if (haveDevices) {
+        for (const auto &deviceLine : qAsConst(jsonArray)) {
             QJsonObject deviceObject = deviceLine.toObject();
             if (! (deviceObject[QLatin1String("type")].toString() == QLatin1String("disk")
                 || (includeLoopback && deviceObject[QLatin1String("type")].toString() == QLatin1String("loop")) ))
@@ -96,6 +151,9 @@ QList<Device*> SfdiskBackend::scanDevices(const ScanFlags scanFlags)
             }
 
             const QString deviceNode = deviceObject[QLatin1String("name")].toString();
+            if (!filter.matches(deviceNode, Device::Type::Disk_Device) && !memberDisks.contains(deviceNode))
+                continue;
+
             if (!includeReadOnly) {
                 QString deviceName = deviceNode;
                 deviceName.remove(QStringLiteral("/dev/"));
@@ -107,21 +165,33 @@ QList<Device*> SfdiskBackend::scanDevices(const ScanFlags scanFlags)
             deviceNodes << deviceNode;
         }
 
+        SfdiskProbeCache::prefetch(deviceNodes + partitionNodes(deviceNodes));
+
         int totalDevices = deviceNodes.length();
         for (int i = 0; i < totalDevices; ++i) {
             const QString deviceNode = deviceNodes[i];
 
             emitScanProgress(deviceNode, i * 100 / totalDevices);
-            Device* device = scanDevice(deviceNode);
+            Device* device = scanDevice(deviceNode, scanFlags);
             if (device != nullptr) {
                 result.append(device);
             }
         }
-        
+
+        SfdiskScanCache::save();
+        if (qEnvironmentVariableIsSet("KPMCORE_DEBUG"))
+            qDebug() << "scan snapshot cache:" << SfdiskScanCache::hits() << "of" << SfdiskScanCache::lookups() << "devices restored";
     }
 
-    VolumeManagerDevice::scanDevices(result); // scan all types of VolumeManagerDevices
+    // scan all types of VolumeManagerDevices
+    if (filter.matchesAll())
+        VolumeManagerDevice::scanDevices(result);
+    else
+        VolumeManagerDevice::scanDevices(result, filter);
 
+    VolumeManagerDevice::endScan();
+    if (ownsInventory)
+        m_Inventory.clear();
     return result;
 }
 
@@ -132,88 +202,135 @@ QList<Device*> SfdiskBackend::scanDevices(const ScanFlags scanFlags)
 */
 Device* SfdiskBackend::scanDevice(const QString& deviceNode)
 {
-    ExternalCommand modelCommand(QStringLiteral("lsblk"),
-                        { QStringLiteral("--nodeps"),
-                          QStringLiteral("--noheadings"),
-                          QStringLiteral("--output"), QStringLiteral("model"),
-                          deviceNode });
-    ExternalCommand sizeCommand(QStringLiteral("blockdev"), { QStringLiteral("--getsize64"), deviceNode });
-    ExternalCommand sizeCommand2(QStringLiteral("blockdev"), { QStringLiteral("--getss"), deviceNode });
-    ExternalCommand jsonCommand(QStringLiteral("sfdisk"), { QStringLiteral("--json"), deviceNode }, QProcess::ProcessChannelMode::SeparateChannels );
-
-    if ( sizeCommand.run(-1) && sizeCommand.exitCode() == 0
-         && sizeCommand2.run(-1) && sizeCommand2.exitCode() == 0
-         && jsonCommand.run(-1) )
-    {
-        Device* d = nullptr;
-        qint64 deviceSize = sizeCommand.output().trimmed().toLongLong();
-        int logicalSectorSize = sizeCommand2.output().trimmed().toLongLong();
+    Device* d = scanDevice(deviceNode, ScanFlags());
+    SfdiskScanCache::save();
+    return d;
+}
+
+/** Create a Device for the given device_node, restoring it from the scan cache if it has not changed.
+    @param deviceNode the device node (e.g. "/dev/sda")
+    @param scanFlags scan depth and whether the scan cache may be used
+    @return the created Device object. callers need to free this.
+*/
+Device* SfdiskBackend::scanDevice(const QString& deviceNode, const ScanFlags scanFlags)
+{
+    const bool useCache = !scanFlags.testFlag(ScanFlag::forceFullRescan);
+
+    const auto inventory = m_Inventory.constFind(deviceNode);
+    const bool inInventory = inventory != m_Inventory.constEnd();
+
+    // Properties from the inventory were read during this scan
+    if (!inInventory)
+        SfdiskProbeCache::invalidate(deviceNode);
+
+    SfdiskDeviceSnapshot snapshot = SfdiskScanCache::identify(deviceNode);
+    SfdiskDeviceSnapshot cached;
+    if (useCache && SfdiskScanCache::find(snapshot, cached) && cached.logicalSectorSize > 0) {
+        Log(Log::Level::information) << xi18nc("@info:status", "Device found: %1", cached.name);
+
+        snapshot.name = cached.name;
+        snapshot.icon = cached.icon;
+        snapshot.logicalSectorSize = cached.logicalSectorSize;
+        Device* d = new DiskDevice(cached.name, deviceNode, 255, 63, cached.size / cached.logicalSectorSize / 255 / 63, cached.logicalSectorSize, cached.icon);
+        return scanPartitionTable(d, scanFlags, snapshot, &cached);
+    }
 
-        QFile mdstat(QStringLiteral("/proc/mdstat"));
+    qint64 deviceSize = 0;
+    int logicalSectorSize = 0;
+    bool haveSize = false;
+    bool haveModel = false;
+    QString name;
+    QString transport;
+
+    if (inInventory) {
+        deviceSize = inventory->value(QLatin1String("size")).toVariant().toLongLong();
+        logicalSectorSize = inventory->value(QLatin1String("log-sec")).toVariant().toInt();
+        haveSize = deviceSize > 0 && logicalSectorSize > 0;
+
+        name = inventory->value(QLatin1String("model")).toString().trimmed().replace(QLatin1Char('_'), QLatin1Char(' '));
+        if (name.trimmed().isEmpty())
+            name = inventory->value(QLatin1String("kname")).toString().trimmed();
+        haveModel = true;
+        transport = inventory->value(QLatin1String("tran")).toString().trimmed();
+    }
+    else {
+        ExternalCommand modelCommand(QStringLiteral("lsblk"),
+                            { QStringLiteral("--nodeps"),
+                              QStringLiteral("--noheadings"),
+                              QStringLiteral("--output"), QStringLiteral("model"),
+                              deviceNode });
+        // Get 'lsblk --output kname' in the cases where the model name is not available.
+        // As lsblk doesn't have an option to include a separator in its output, it is
+        // necessary to run it again getting only the kname as output.
+        ExternalCommand knameCommand(QStringLiteral("lsblk"), { QStringLiteral("--nodeps"), QStringLiteral("--noheadings"), QStringLiteral("--output"), QStringLiteral("kname"),
+                                                                deviceNode});
+        ExternalCommand transportCommand(QStringLiteral("lsblk"), { QStringLiteral("--nodeps"), QStringLiteral("--noheadings"), QStringLiteral("--output"), QStringLiteral("tran"),
+                                                                    deviceNode});
+        ExternalCommand sizeCommand(QStringLiteral("blockdev"), { QStringLiteral("--getsize64"), deviceNode });
+        ExternalCommand sizeCommand2(QStringLiteral("blockdev"), { QStringLiteral("--getss"), deviceNode });
+
+        // Query everything about the device with a single helper round trip
+        const bool batchSucceeded = ExternalCommand::runBatch({ &sizeCommand, &sizeCommand2, &modelCommand, &knameCommand, &transportCommand });
+
+        if ( batchSucceeded && sizeCommand.exitCode() == 0 && sizeCommand2.exitCode() == 0 )
+        {
+            deviceSize = sizeCommand.output().trimmed().toLongLong();
+            logicalSectorSize = sizeCommand2.output().trimmed().toLongLong();
+            haveSize = true;
+
+            if (modelCommand.exitCode() == 0) {
+                name = modelCommand.output();
+                name = name.left(name.length() - 1).replace(QLatin1Char('_'), QLatin1Char(' '));
 
-        if (mdstat.open(QIODevice::ReadOnly)) {
-            QTextStream stream(&mdstat);
+                if (name.trimmed().isEmpty() && knameCommand.exitCode() == 0)
+                    name = knameCommand.output().trimmed();
+                haveModel = true;
+            }
+
+            if (transportCommand.exitCode() == 0)
+                transport = transportCommand.output().trimmed();
+        }
+    }
 
-            QString content = stream.readAll();
+    if ( haveSize )
+    {
+        Device* d = nullptr;
 
-            mdstat.close();
+        const QString content = SoftwareRAID::mdstat();
 
+        if (!content.isEmpty()) {
             QRegularExpression re(QStringLiteral("md([\\/\\w]+)\\s+:"));
             QRegularExpressionMatchIterator i  = re.globalMatch(content);
 
             while (i.hasNext()) {
                 QRegularExpressionMatch reMatch = i.next();
-                QString name = reMatch.captured(1);
+                const QString raidName = reMatch.captured(1);
 
-                if ((QStringLiteral("/dev/md") + name) == deviceNode) {
+                if ((QStringLiteral("/dev/md") + raidName) == deviceNode) {
                     Log(Log::Level::information) << xi18nc("@info:status", "Software RAID Device found: %1", deviceNode);
-                    d = new SoftwareRAID( QStringLiteral("md") + name, SoftwareRAID::Status::Active );
+                    d = new SoftwareRAID( QStringLiteral("md") + raidName, SoftwareRAID::Status::Active );
                     break;
                 }
             }
         }
 
-        if ( d == nullptr && modelCommand.run(-1) && modelCommand.exitCode() == 0 )
+        if ( d == nullptr && haveModel )
         {
-            QString name = modelCommand.output();
-            name = name.left(name.length() - 1).replace(QLatin1Char('_'), QLatin1Char(' '));
-
-            if (name.trimmed().isEmpty()) {
-                // Get 'lsblk --output kname' in the cases where the model name is not available.
-                // As lsblk doesn't have an option to include a separator in its output, it is
-                // necessary to run it again getting only the kname as output.
-                ExternalCommand kname(QStringLiteral("lsblk"), {QStringLiteral("--nodeps"), QStringLiteral("--noheadings"), QStringLiteral("--output"), QStringLiteral("kname"),
-                                                                deviceNode});
-
-                if (kname.run(-1) && kname.exitCode() == 0)
-                    name = kname.output().trimmed();
-            }
-
-            ExternalCommand transport(QStringLiteral("lsblk"), {QStringLiteral("--nodeps"), QStringLiteral("--noheadings"), QStringLiteral("--output"), QStringLiteral("tran"),
-                                                                deviceNode});
             QString icon;
-            if (transport.run(-1) && transport.exitCode() == 0)
-                if (transport.output().trimmed() == QStringLiteral("usb"))
-                    icon = QStringLiteral("drive-removable-media-usb");
+            if (transport == QStringLiteral("usb"))
+                icon = QStringLiteral("drive-removable-media-usb");
 
             Log(Log::Level::information) << xi18nc("@info:status", "Device found: %1", name);
 
             d = new DiskDevice(name, deviceNode, 255, 63, deviceSize / logicalSectorSize / 255 / 63, logicalSectorSize, icon);
+
+            snapshot.name = name;
+            snapshot.icon = icon;
+            snapshot.logicalSectorSize = logicalSectorSize;
         }
 
         if ( d )
-        {
-            if (jsonCommand.exitCode() != 0)
-                return d;
-
-            const QJsonObject jsonObject = QJsonDocument::fromJson(jsonCommand.rawOutput()).object();
-            const QJsonObject partitionTable = jsonObject[QLatin1String("partitiontable")].toObject();
-
-            if (!updateDevicePartitionTable(*d, partitionTable))
-                return nullptr;
-
-            return d;
-        }
+            return scanPartitionTable(d, scanFlags, snapshot, useCache ? &cached : nullptr);
     }
     else
     {
@@ -222,8 +339,12 @@ Device* SfdiskBackend::scanDevice(const QString& deviceNode)
 
         if (checkVG.run(-1) && checkVG.exitCode() == 0)
         {
-            QList<Device *> availableDevices = scanDevices();
+            // Only scan this volume group and the disks holding its physical volumes. Their
+            // partitions are only needed as physical volumes, so file system details are skipped.
+            const DeviceFilter filter({ deviceNode }, { Device::Type::LVM_Device });
+            QList<Device *> availableDevices = scanDevices(filter, ScanFlag::includeReadOnly | ScanFlag::includeLoopback | ScanFlag::layoutOnly);
 
+            // The other devices stay alive: the LvmDevice refers to partitions on them
             for (Device *device : qAsConst(availableDevices))
                 if (device->deviceNode() == deviceNode)
                     return device;
@@ -232,16 +353,68 @@ Device* SfdiskBackend::scanDevice(const QString& deviceNode)
     return nullptr;
 }
 
+/** Reads the partition table of a Device and scans its Partitions.
+    @param d the Device
+    @param scanFlags scan depth
+    @param snapshot receives the scan results to be stored in the scan cache
+    @param cached snapshot of a previous scan of this disk or nullptr
+    @return the Device or nullptr if the partition table is invalid
+*/
+Device* SfdiskBackend::scanPartitionTable(Device* d, const ScanFlags scanFlags, SfdiskDeviceSnapshot& snapshot, const SfdiskDeviceSnapshot* cached)
+{
+    // GPT and MBR are read in-process, sfdisk is only needed for other partition table types
+    SfdiskTableReader reader(*d);
+    QJsonObject partitionTable = reader.read();
+
+    if (partitionTable.isEmpty()) {
+        ExternalCommand jsonCommand(QStringLiteral("sfdisk"), { QStringLiteral("--json"), d->deviceNode() }, QProcess::ProcessChannelMode::SeparateChannels );
+        if (!jsonCommand.run(-1) || jsonCommand.exitCode() != 0)
+            return d;
+
+        const QJsonObject jsonObject = QJsonDocument::fromJson(jsonCommand.rawOutput()).object();
+        partitionTable = jsonObject[QLatin1String("partitiontable")].toObject();
+    }
+
+    // Partitions are only restored from the snapshot if the partition table did not change
+    const QByteArray table = QJsonDocument(partitionTable).toJson(QJsonDocument::Compact);
+    snapshot.tableChecksum = SfdiskTableReader::crc32(table.constData(), table.size());
+    if (cached && (cached->identity.isEmpty() || cached->tableChecksum != snapshot.tableChecksum))
+        cached = nullptr;
+    if (!snapshot.identity.isEmpty())
+        SfdiskScanCache::countLookup(cached != nullptr);
+
+    if (!updateDevicePartitionTable(*d, partitionTable, scanFlags, snapshot, cached))
+        return nullptr;
+
+    if (d->type() == Device::Type::Disk_Device)
+        SfdiskScanCache::store(snapshot);
+
+    return d;
+}
+
 /** Scans a Device for Partitions.
 
     This method  will scan a Device for all Partitions on it, detect the FileSystem for each Partition,
     try to determine the FileSystem usage, read the FileSystem label and store it all in newly created
     objects that are in the end added to the Device's PartitionTable.
+
+    Partitions found unchanged in @p cached take their file system, label, UUID and
+    usage from there instead of probing them again. Details skipped because of
+    ScanFlag::layoutOnly or ScanFlag::identityOnly are loaded on first access.
 */
-void SfdiskBackend::scanDevicePartitions(Device& d, const QJsonArray& jsonPartitions)
+void SfdiskBackend::scanDevicePartitions(Device& d, const QJsonArray& jsonPartitions, const ScanFlags scanFlags, SfdiskDeviceSnapshot& snapshot, const SfdiskDeviceSnapshot* cached)
 {
     Q_ASSERT(d.partitionTable());
 
+    const bool layoutOnly = scanFlags.testFlag(ScanFlag::layoutOnly);
+    const bool identityOnly = layoutOnly || scanFlags.testFlag(ScanFlag::identityOnly);
+
+    // Probe all partitions at once, detectFileSystem(), readLabel() and readUUID() are then served from the cache
+    QStringList partitionNodes;
+    for (const auto &partition : jsonPartitions)
+        partitionNodes.append(partition.toObject()[QLatin1String("node")].toString());
+    SfdiskProbeCache::prefetch(partitionNodes);
+
     QList<Partition*> partitions;
     for (const auto &partition : jsonPartitions) {
         const QJsonObject partitionObject = partition.toObject();
@@ -256,8 +429,22 @@ void SfdiskBackend::scanDevicePartitions(Device& d, const QJsonArray& jsonPartit
         else if (partitionType == QStringLiteral("21686148-6449-6E6F-744E-656564454649"))
             activeFlags |= PartitionTable::Flag::BiosGrub;
 
+        // mkfs, e2label or tune2fs only change the udev database entry of the partition itself
+        const qint64 modified = SfdiskProbeCache::probe(partitionNode).modified;
+        const SfdiskPartitionSnapshot* cachedPartition = nullptr;
+        if (cached && modified != -1) {
+            const auto it = cached->partitions.constFind(start);
+            if (it != cached->partitions.constEnd() && it->lastSector == start + size - 1 && it->modified == modified)
+                cachedPartition = &it.value();
+        }
+
         FileSystem::Type type = FileSystem::Type::Unknown;
-        type = detectFileSystem(partitionNode);
+        type = cachedPartition ? static_cast<FileSystem::Type>(cachedPartition->fileSystemType) : detectFileSystem(partitionNode);
+
+        // LUKS containers always need to be opened to find out about their contents
+        if (type == FileSystem::Type::Luks || type == FileSystem::Type::Luks2)
+            cachedPartition = nullptr;
+
         PartitionRole::Roles r = PartitionRole::Primary;
 
         if ( (d.partitionTable()->type() == PartitionTable::msdos || d.partitionTable()->type() == PartitionTable::msdos_sectorbased) &&
@@ -295,19 +482,50 @@ void SfdiskBackend::scanDevicePartitions(Device& d, const QJsonArray& jsonPartit
 
         Partition* part = new Partition(parent, d, PartitionRole(r), fs, start, start + size - 1, partitionNode, availableFlags(d.partitionTable()->type()), mountPoint, mounted, activeFlags);
 
-        if (!part->roles().has(PartitionRole::Luks))
+        const bool isLuks = part->roles().has(PartitionRole::Luks);
+        const bool deferIdentity = layoutOnly && !cachedPartition && !isLuks;
+        const bool deferUsage = identityOnly && !isLuks && !mounted;
+
+        // Usage is never restored from the snapshot: writes to a file system change neither
+        // the partition table nor the udev database
+        if (!isLuks && !deferUsage)
             readSectorsUsed(d, *part, mountPoint);
 
-        if (fs->supportGetLabel() != FileSystem::cmdSupportNone)
-            fs->setLabel(fs->readLabel(part->deviceNode()));
+        if (fs->supportGetLabel() != FileSystem::cmdSupportNone && !deferIdentity)
+            fs->setLabel(cachedPartition ? cachedPartition->label : fs->readLabel(part->deviceNode()));
 
         if (d.partitionTable()->type() == PartitionTable::TableType::gpt) {
             part->setLabel(partitionObject[QLatin1String("name")].toString());
             part->setUUID(partitionObject[QLatin1String("uuid")].toString());
         }
 
-        if (fs->supportGetUUID() != FileSystem::cmdSupportNone)
-            fs->setUUID(fs->readUUID(part->deviceNode()));
+        if (fs->supportGetUUID() != FileSystem::cmdSupportNone && !deferIdentity)
+            fs->setUUID(cachedPartition ? cachedPartition->uuid : fs->readUUID(part->deviceNode()));
+
+        if (deferIdentity || deferUsage) {
+            const qint64 sectorSize = d.logicalSize();
+            fs->setDetailsLoader([partitionNode, sectorSize, deferIdentity, deferUsage] (FileSystem& lazyFs) {
+                if (deferIdentity) {
+                    if (lazyFs.supportGetLabel() != FileSystem::cmdSupportNone)
+                        lazyFs.setLabel(lazyFs.readLabel(partitionNode));
+                    if (lazyFs.supportGetUUID() != FileSystem::cmdSupportNone)
+                        lazyFs.setUUID(lazyFs.readUUID(partitionNode));
+                }
+                if (deferUsage && lazyFs.supportGetUsed() != FileSystem::cmdSupportNone)
+                    lazyFs.setSectorsUsed(lazyFs.readUsedCapacity(partitionNode) / sectorSize);
+            });
+        }
+
+        // Partitions with label and UUID still to be loaded are left out of the snapshot
+        if (!deferIdentity) {
+            SfdiskPartitionSnapshot partitionSnapshot;
+            partitionSnapshot.lastSector = start + size - 1;
+            partitionSnapshot.modified = modified;
+            partitionSnapshot.fileSystemType = fs->type();
+            partitionSnapshot.label = fs->label();
+            partitionSnapshot.uuid = fs->uuid();
+            snapshot.partitions.insert(start, partitionSnapshot);
+        }
 
         parent->append(part);
         partitions.append(part);
@@ -322,7 +540,7 @@ void SfdiskBackend::scanDevicePartitions(Device& d, const QJsonArray& jsonPartit
         PartitionAlignment::isAligned(d, *part);
 }
 
-bool SfdiskBackend::updateDevicePartitionTable(Device &d, const QJsonObject &jsonPartitionTable)
+bool SfdiskBackend::updateDevicePartitionTable(Device &d, const QJsonObject &jsonPartitionTable, const ScanFlags scanFlags, SfdiskDeviceSnapshot& snapshot, const SfdiskDeviceSnapshot* cached)
 {
     QString tableType = jsonPartitionTable[QLatin1String("label")].toString();
     const PartitionTable::TableType type = PartitionTable::nameToTableType(tableType);
@@ -354,8 +572,13 @@ bool SfdiskBackend::updateDevicePartitionTable(Device &d, const QJsonObject &jso
     switch (type) {
     case PartitionTable::gpt:
     {
-        // Read the maximum number of GPT partitions
-        qint32 maxEntries;
+        // Read the maximum number of GPT partitions unless SfdiskTableReader already provided it
+        qint32 maxEntries = jsonPartitionTable[QLatin1String("maxentries")].toInt();
+        if (maxEntries > 0) {
+            CoreBackend::setPartitionTableMaxPrimaries(*d.partitionTable(), maxEntries);
+            break;
+        }
+
         QByteArray gptHeader;
         CopySourceDevice source(d, 512, 1023);
         CopyTargetByteArray target(gptHeader);
@@ -376,7 +599,7 @@ bool SfdiskBackend::updateDevicePartitionTable(Device &d, const QJsonObject &jso
         break;
     }
 
-    scanDevicePartitions(d, jsonPartitionTable[QLatin1String("partitions")].toArray());
+    scanDevicePartitions(d, jsonPartitionTable[QLatin1String("partitions")].toArray(), scanFlags, snapshot, cached);
 
     return true;
 }
@@ -392,7 +615,7 @@ void SfdiskBackend::readSectorsUsed(const Device& d, Partition& p, const QString
         if (p.isMounted() && storage.isValid())
             p.fileSystem().setSectorsUsed( (storage.bytesTotal() - storage.bytesFree()) / d.logicalSize());
     }
-    else if (p.fileSystem().supportGetUsed() == FileSystem::cmdSupportFileSystem)
+    else if (p.fileSystem().supportGetUsed() != FileSystem::cmdSupportNone)
         p.fileSystem().setSectorsUsed(p.fileSystem().readUsedCapacity(p.deviceNode()) / d.logicalSize());
 }
 
@@ -400,70 +623,12 @@ FileSystem::Type SfdiskBackend::detectFileSystem(const QString& partitionPath)
 {
     FileSystem::Type rval = FileSystem::Type::Unknown;
 
-    ExternalCommand udevCommand(QStringLiteral("udevadm"), {
-                                 QStringLiteral("info"),
-                                 QStringLiteral("--query=property"),
-                                 partitionPath });
-
-    if (udevCommand.run(-1) && udevCommand.exitCode() == 0) {
-        QRegularExpression re(QStringLiteral("ID_FS_TYPE=(\\w+)"));
-        QRegularExpression re2(QStringLiteral("ID_FS_VERSION=(\\w+)"));
-        QRegularExpressionMatch reFileSystemType = re.match(udevCommand.output());
-        QRegularExpressionMatch reFileSystemVersion = re2.match(udevCommand.output());
+    const SfdiskProbe probe = SfdiskProbeCache::probe(partitionPath);
 
-        QString s;
-        if (reFileSystemType.hasMatch()) {
-            s = reFileSystemType.captured(1);
-        }
-
-        QString version;
-        if (reFileSystemVersion.hasMatch()) {
-            version = reFileSystemVersion.captured(1);
-        }
-
-        if (s == QStringLiteral("ext2")) rval = FileSystem::Type::Ext2;
-        else if (s == QStringLiteral("ext3")) rval = FileSystem::Type::Ext3;
-        else if (s.startsWith(QStringLiteral("ext4"))) rval = FileSystem::Type::Ext4;
-        else if (s == QStringLiteral("swap")) rval = FileSystem::Type::LinuxSwap;
-        else if (s == QStringLiteral("ntfs")) rval = FileSystem::Type::Ntfs;
-        else if (s == QStringLiteral("reiserfs")) rval = FileSystem::Type::ReiserFS;
-        else if (s == QStringLiteral("reiser4")) rval = FileSystem::Type::Reiser4;
-        else if (s == QStringLiteral("xfs")) rval = FileSystem::Type::Xfs;
-        else if (s == QStringLiteral("jfs")) rval = FileSystem::Type::Jfs;
-        else if (s == QStringLiteral("hfs")) rval = FileSystem::Type::Hfs;
-        else if (s == QStringLiteral("hfsplus")) rval = FileSystem::Type::HfsPlus;
-        else if (s == QStringLiteral("ufs")) rval = FileSystem::Type::Ufs;
-        else if (s == QStringLiteral("vfat")) {
-            if (version == QStringLiteral("FAT32"))
-                rval = FileSystem::Type::Fat32;
-            else if (version == QStringLiteral("FAT16"))
-                rval = FileSystem::Type::Fat16;
-            else if (version == QStringLiteral("FAT12"))
-                rval = FileSystem::Type::Fat12;
-        }
-        else if (s == QStringLiteral("btrfs")) rval = FileSystem::Type::Btrfs;
-        else if (s == QStringLiteral("ocfs2")) rval = FileSystem::Type::Ocfs2;
-        else if (s == QStringLiteral("zfs_member")) rval = FileSystem::Type::Zfs;
-        else if (s == QStringLiteral("hpfs")) rval = FileSystem::Type::Hpfs;
-        else if (s == QStringLiteral("crypto_LUKS")) {
-            if (version == QStringLiteral("1"))
-                rval = FileSystem::Type::Luks;
-            else if (version == QStringLiteral("2")) {
-                rval = FileSystem::Type::Luks2;
-            }
-        }
-        else if (s == QStringLiteral("exfat")) rval = FileSystem::Type::Exfat;
-        else if (s == QStringLiteral("nilfs2")) rval = FileSystem::Type::Nilfs2;
-        else if (s == QStringLiteral("LVM2_member")) rval = FileSystem::Type::Lvm2_PV;
-        else if (s == QStringLiteral("f2fs")) rval = FileSystem::Type::F2fs;
-        else if (s == QStringLiteral("udf")) rval = FileSystem::Type::Udf;
-        else if (s == QStringLiteral("iso9660")) rval = FileSystem::Type::Iso9660;
-        else if (s == QStringLiteral("linux_raid_member")) rval = FileSystem::Type::LinuxRaidMember;
-        else if (s == QStringLiteral("BitLocker")) rval = FileSystem::Type::BitLocker;
-        else if (s == QStringLiteral("apfs")) rval = FileSystem::Type::Apfs;
-        else if (s == QStringLiteral("minix")) rval = FileSystem::Type::Minix;
-        else
-            qWarning() << "unknown file system type " << s << " on " << partitionPath;
+    if (probe.valid) {
+        rval = FileSystemTypes::typeForUdevName(probe.fsType, probe.fsVersion);
+        if (rval == FileSystem::Type::Unknown && !FileSystemTypes::isUdevName(probe.fsType))
+            qWarning() << "unknown file system type " << probe.fsType << " on " << partitionPath;
     }
 
     return rval;
@@ -471,32 +636,12 @@ FileSystem::Type SfdiskBackend::detectFileSystem(const QString& partitionPath)
 
 QString SfdiskBackend::readLabel(const QString& deviceNode) const
 {
-    ExternalCommand udevCommand(QStringLiteral("udevadm"), {
-                                 QStringLiteral("info"),
-                                 QStringLiteral("--query=property"),
-                                 deviceNode });
-    udevCommand.run();
-    QRegularExpression re(QStringLiteral("ID_FS_LABEL=(.*)"));
-    QRegularExpressionMatch reFileSystemLabel = re.match(udevCommand.output());
-    if (reFileSystemLabel.hasMatch())
-        return reFileSystemLabel.captured(1);
-
-    return QString();
+    return SfdiskProbeCache::probe(deviceNode).fsLabel;
 }
 
 QString SfdiskBackend::readUUID(const QString& deviceNode) const
 {
-    ExternalCommand udevCommand(QStringLiteral("udevadm"), {
-                                 QStringLiteral("info"),
-                                 QStringLiteral("--query=property"),
-                                 deviceNode });
-    udevCommand.run();
-    QRegularExpression re(QStringLiteral("ID_FS_UUID=(.*)"));
-    QRegularExpressionMatch reFileSystemUUID = re.match(udevCommand.output());
-    if (reFileSystemUUID.hasMatch())
-        return reFileSystemUUID.captured(1);
-
-    return QString();
+    return SfdiskProbeCache::probe(deviceNode).fsUUID;
 }
 
 PartitionTable::Flags SfdiskBackend::availableFlags(PartitionTable::TableType type)
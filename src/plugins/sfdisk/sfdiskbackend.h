@@ -23,11 +23,14 @@
 #include "core/partition.h"
 #include "fs/filesystem.h"
 
+#include <QHash>
+#include <QJsonObject>
 #include <QList>
 #include <QVariant>
 
 class Device;
 class KPluginFactory;
+struct SfdiskDeviceSnapshot;
 class QString;
 
 /** Backend plugin for sfdisk
@@ -48,6 +51,7 @@ public:
 
     QList<Device*> scanDevices(bool excludeReadOnly = false) override;
     QList<Device*> scanDevices(const ScanFlags scanFlags) override;
+    QList<Device*> scanDevices(const DeviceFilter& filter, const ScanFlags scanFlags) override;
     std::unique_ptr<CoreBackendDevice> openDevice(const Device& d) override;
     std::unique_ptr<CoreBackendDevice> openDeviceExclusive(const Device& d) override;
     bool closeDevice(std::unique_ptr<CoreBackendDevice> coreDevice) override;
@@ -58,9 +62,14 @@ public:
 
 private:
     static void readSectorsUsed(const Device& d, Partition& p, const QString& mountPoint);
-    void scanDevicePartitions(Device& d, const QJsonArray& jsonPartitions);
-    bool updateDevicePartitionTable(Device& d, const QJsonObject& jsonPartitionTable);
+    Device* scanDevice(const QString& deviceNode, const ScanFlags scanFlags);
+    Device* scanPartitionTable(Device* d, const ScanFlags scanFlags, SfdiskDeviceSnapshot& snapshot, const SfdiskDeviceSnapshot* cached);
+    void scanDevicePartitions(Device& d, const QJsonArray& jsonPartitions, const ScanFlags scanFlags, SfdiskDeviceSnapshot& snapshot, const SfdiskDeviceSnapshot* cached);
+    bool updateDevicePartitionTable(Device& d, const QJsonObject& jsonPartitionTable, const ScanFlags scanFlags, SfdiskDeviceSnapshot& snapshot, const SfdiskDeviceSnapshot* cached);
     static PartitionTable::Flags availableFlags(PartitionTable::TableType type);
+
+private:
+    QHash<QString, QJsonObject> m_Inventory;
 };
 
 #endif
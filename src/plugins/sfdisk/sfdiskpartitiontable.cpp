@@ -16,6 +16,8 @@
  *************************************************************************/
 
 #include "plugins/sfdisk/sfdiskpartitiontable.h"
+#include "plugins/sfdisk/sfdiskprobecache.h"
+#include "plugins/sfdisk/sfdiskscancache.h"
 
 #include "backend/corebackend.h"
 #include "backend/corebackendmanager.h"
@@ -25,6 +27,7 @@
 #include "core/raid/softwareraid.h"
 
 #include "fs/filesystem.h"
+#include "fs/filesystemtypes.h"
 
 #include "util/report.h"
 #include "util/externalcommand.h"
@@ -64,6 +67,9 @@ bool SfdiskPartitionTable::commit(quint32 timeout)
         ExternalCommand(QStringLiteral("udevadm"), { QStringLiteral("control"), QStringLiteral("--start-exec-queue") }).run();
 
     ExternalCommand(QStringLiteral("udevadm"), { QStringLiteral("settle"), QStringLiteral("--timeout=") + QString::number(timeout) }).run();
+
+    SfdiskProbeCache::invalidate(m_device->deviceNode());
+    SfdiskScanCache::invalidate(m_device->deviceNode());
     return true;
 }
 
@@ -167,50 +173,18 @@ FileSystem::Type SfdiskPartitionTable::detectFileSystemBySector(Report& report,
     return type;
 }
 
-static struct {
-    FileSystem::Type type;
-    QLatin1String partitionType[2]; // GPT, MBR
-} typemap[] = {
-    { FileSystem::Type::Btrfs, { QLatin1String("0FC63DAF-8483-4772-8E79-3D69D8477DE4"), QLatin1String("83") } },
-    { FileSystem::Type::Ext2, { QLatin1String("0FC63DAF-8483-4772-8E79-3D69D8477DE4"), QLatin1String("83") } },
-    { FileSystem::Type::Ext3, { QLatin1String("0FC63DAF-8483-4772-8E79-3D69D8477DE4"), QLatin1String("83") } },
-    { FileSystem::Type::Ext4, { QLatin1String("0FC63DAF-8483-4772-8E79-3D69D8477DE4"), QLatin1String("83") } },
-    { FileSystem::Type::LinuxSwap, { QLatin1String("0657FD6D-A4AB-43C4-84E5-0933C84B4F4F"), QLatin1String("82") } },
-    { FileSystem::Type::Fat12, { QLatin1String("EBD0A0A2-B9E5-4433-87C0-68B6B72699C7"), QLatin1String("6") } },
-    { FileSystem::Type::Fat16, { QLatin1String("EBD0A0A2-B9E5-4433-87C0-68B6B72699C7"), QLatin1String("6") } },
-    { FileSystem::Type::Fat32, { QLatin1String("EBD0A0A2-B9E5-4433-87C0-68B6B72699C7"), QLatin1String("c") } },
-    { FileSystem::Type::Nilfs2, { QLatin1String("0FC63DAF-8483-4772-8E79-3D69D8477DE4"), QLatin1String("83") } },
-    { FileSystem::Type::Ntfs, { QLatin1String("EBD0A0A2-B9E5-4433-87C0-68B6B72699C7"), QLatin1String("7") } },
-    { FileSystem::Type::Exfat, { QLatin1String("EBD0A0A2-B9E5-4433-87C0-68B6B72699C7"), QLatin1String("7") } },
-    { FileSystem::Type::ReiserFS, { QLatin1String("0FC63DAF-8483-4772-8E79-3D69D8477DE4"), QLatin1String("83") } },
-    { FileSystem::Type::Reiser4, { QLatin1String("0FC63DAF-8483-4772-8E79-3D69D8477DE4"), QLatin1String("83") } },
-    { FileSystem::Type::Xfs, { QLatin1String("0FC63DAF-8483-4772-8E79-3D69D8477DE4"), QLatin1String("83") } },
-    { FileSystem::Type::Jfs, { QLatin1String("0FC63DAF-8483-4772-8E79-3D69D8477DE4"), QLatin1String("83") } },
-    { FileSystem::Type::Hfs, { QLatin1String("48465300-0000-11AA-AA11-00306543ECAC"), QLatin1String("af")} },
-    { FileSystem::Type::HfsPlus, { QLatin1String("48465300-0000-11AA-AA11-00306543ECAC"), QLatin1String("af") } },
-    { FileSystem::Type::Udf, { QLatin1String("EBD0A0A2-B9E5-4433-87C0-68B6B72699C7"), QLatin1String("7") } }
-    // Add ZFS too
-};
-
 static QLatin1String getPartitionType(FileSystem::Type t, PartitionTable::TableType tableType)
 {
-    quint8 type;
+    const FileSystemTypes::Info info = FileSystemTypes::infoForType(t);
     switch (tableType) {
     case PartitionTable::TableType::gpt:
-        type = 0;
-        break;
+        return QLatin1String(info.gptType);
     case PartitionTable::TableType::msdos:
     case PartitionTable::TableType::msdos_sectorbased:
-        type = 1;
-        break;
+        return QLatin1String(info.mbrType);
     default:;
         return QLatin1String();
     }
-    for (quint32 i = 0; i < sizeof(typemap) / sizeof(typemap[0]); i++)
-        if (typemap[i].type == t)
-            return typemap[i].partitionType[type];
-
-    return QLatin1String();
 }
 
 bool SfdiskPartitionTable::setPartitionLabel(Report& report, const Partition& partition, const QString& label)
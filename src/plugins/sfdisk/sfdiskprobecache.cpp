@@ -0,0 +1,236 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#include "plugins/sfdisk/sfdiskprobecache.h"
+
+#include "util/externalcommand.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <memory>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+struct SfdiskProbeCacheEntry
+{
+    dev_t deviceNumber;
+    qint64 databaseModified; /**< modification time of the udev database file or -1 if udevadm was used */
+    SfdiskProbe probe;
+};
+
+static QMutex cacheMutex;
+static QHash<QString, SfdiskProbeCacheEntry> cache;
+
+static dev_t deviceNumber(const QString& deviceNode)
+{
+    struct stat st;
+    if (stat(QFile::encodeName(deviceNode).constData(), &st) == 0 && S_ISBLK(st.st_mode))
+        return st.st_rdev;
+
+    return 0;
+}
+
+static QString databasePath(dev_t number)
+{
+    return QStringLiteral("/run/udev/data/b%1:%2").arg(major(number)).arg(minor(number));
+}
+
+static qint64 databaseModified(dev_t number)
+{
+    if (number == 0)
+        return -1;
+
+    const QFileInfo database(databasePath(number));
+    return database.exists() ? database.lastModified().toMSecsSinceEpoch() : -1;
+}
+
+/** Parses KEY=value lines, optionally prefixed (e.g. with "E:" in the udev database) */
+static SfdiskProbe parseProperties(const QByteArray& data, const QByteArray& prefix)
+{
+    SfdiskProbe probe;
+    probe.valid = true;
+
+    for (const QByteArray& rawLine : data.split('\n')) {
+        if (!rawLine.startsWith(prefix))
+            continue;
+
+        const QByteArray line = rawLine.mid(prefix.size());
+        const int separator = line.indexOf('=');
+        if (separator <= 0 || !(line.startsWith("ID_FS_") || line.startsWith("ID_PART_") ||
+                                line.startsWith("ID_WWN") || line.startsWith("ID_SERIAL")))
+            continue;
+
+        probe.properties.insert(QString::fromLocal8Bit(line.left(separator)), QString::fromLocal8Bit(line.mid(separator + 1)));
+    }
+
+    probe.fsType = probe.properties.value(QStringLiteral("ID_FS_TYPE"));
+    probe.fsVersion = probe.properties.value(QStringLiteral("ID_FS_VERSION"));
+    probe.fsLabel = probe.properties.value(QStringLiteral("ID_FS_LABEL"));
+    probe.fsUUID = probe.properties.value(QStringLiteral("ID_FS_UUID"));
+    probe.partEntryName = probe.properties.value(QStringLiteral("ID_PART_ENTRY_NAME"));
+    probe.partEntryUUID = probe.properties.value(QStringLiteral("ID_PART_ENTRY_UUID"));
+    probe.partEntryType = probe.properties.value(QStringLiteral("ID_PART_ENTRY_TYPE"));
+
+    return probe;
+}
+
+/** Reads properties from the udev database without spawning any process.
+    @return true if the database entry could be read
+*/
+static bool readDatabase(dev_t number, SfdiskProbeCacheEntry& entry)
+{
+    if (number == 0)
+        return false;
+
+    QFile database(databasePath(number));
+    if (!database.open(QIODevice::ReadOnly))
+        return false;
+
+    entry.deviceNumber = number;
+    entry.databaseModified = databaseModified(number);
+    entry.probe = parseProperties(database.readAll(), QByteArrayLiteral("E:"));
+    entry.probe.modified = entry.databaseModified;
+
+    return true;
+}
+
+static bool isFresh(const QString& deviceNode, dev_t number)
+{
+    const auto it = cache.constFind(deviceNode);
+    if (it == cache.constEnd() || it->deviceNumber != number)
+        return false;
+
+    // Entries obtained from udevadm stay valid until invalidated
+    return it->databaseModified == -1 || it->databaseModified == databaseModified(number);
+}
+
+/** Returns the udev properties of a device node.
+    @param deviceNode the device node (e.g. "/dev/sda1")
+    @return the properties; SfdiskProbe::valid is false if they could not be read
+*/
+SfdiskProbe SfdiskProbeCache::probe(const QString& deviceNode)
+{
+    prefetch({ deviceNode });
+
+    QMutexLocker locker(&cacheMutex);
+    return cache.value(deviceNode).probe;
+}
+
+/** Makes sure the cache holds properties of all given device nodes.
+    Nodes missing in the udev database are queried with one batched helper call.
+    @param deviceNodes the device nodes to probe
+*/
+void SfdiskProbeCache::prefetch(const QStringList& deviceNodes)
+{
+    QStringList missingNodes;
+    QList<dev_t> missingNumbers;
+    {
+        QMutexLocker locker(&cacheMutex);
+        for (const QString& deviceNode : deviceNodes) {
+            const dev_t number = deviceNumber(deviceNode);
+            if (isFresh(deviceNode, number))
+                continue;
+
+            SfdiskProbeCacheEntry entry;
+            if (readDatabase(number, entry)) {
+                cache.insert(deviceNode, entry);
+            }
+            else if (!missingNodes.contains(deviceNode)) {
+                missingNodes.append(deviceNode);
+                missingNumbers.append(number);
+            }
+        }
+    }
+
+    if (missingNodes.isEmpty())
+        return;
+
+    std::vector<std::unique_ptr<ExternalCommand>> commands;
+    QList<ExternalCommand*> batch;
+    for (const QString& deviceNode : qAsConst(missingNodes)) {
+        commands.push_back(std::make_unique<ExternalCommand>(QStringLiteral("udevadm"), QStringList{
+                                 QStringLiteral("info"),
+                                 QStringLiteral("--query=property"),
+                                 deviceNode }));
+        batch.append(commands.back().get());
+    }
+
+    if (!ExternalCommand::runBatch(batch))
+        return;
+
+    QMutexLocker locker(&cacheMutex);
+    for (int i = 0; i < missingNodes.size(); ++i) {
+        SfdiskProbeCacheEntry entry;
+        entry.deviceNumber = missingNumbers[i];
+        entry.databaseModified = -1;
+        if (batch[i]->exitCode() == 0)
+            entry.probe = parseProperties(batch[i]->rawOutput(), QByteArray());
+        cache.insert(missingNodes[i], entry);
+    }
+}
+
+/** Checks whether a node is a device node or one of its partitions.
+    Partitions of devices whose name ends in a digit have a "p" separator (e.g. "/dev/nvme0n1p1").
+*/
+static bool isDeviceOrPartition(const QString& node, const QString& deviceNode)
+{
+    if (node == deviceNode)
+        return true;
+    if (!node.startsWith(deviceNode))
+        return false;
+
+    int position = deviceNode.length();
+    if (!deviceNode.isEmpty() && deviceNode.back().isDigit()) {
+        if (node.at(position) != QLatin1Char('p'))
+            return false;
+        ++position;
+    }
+
+    if (position == node.length())
+        return false;
+    for (; position < node.length(); ++position)
+        if (!node.at(position).isDigit())
+            return false;
+
+    return true;
+}
+
+/** Drops cached properties of a device and all its partitions.
+    @param deviceNode the device node (e.g. "/dev/sda")
+*/
+void SfdiskProbeCache::invalidate(const QString& deviceNode)
+{
+    QMutexLocker locker(&cacheMutex);
+    for (auto it = cache.begin(); it != cache.end(); ) {
+        if (isDeviceOrPartition(it.key(), deviceNode))
+            it = cache.erase(it);
+        else
+            ++it;
+    }
+}
+
+void SfdiskProbeCache::clear()
+{
+    QMutexLocker locker(&cacheMutex);
+    cache.clear();
+}
@@ -0,0 +1,56 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#if !defined(SFDISKPROBECACHE__H)
+
+#define SFDISKPROBECACHE__H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+/** File system and partition properties of a block device as known by udev */
+struct SfdiskProbe
+{
+    bool valid = false;     /**< true if udev knew about the device */
+    QString fsType;         /**< ID_FS_TYPE */
+    QString fsVersion;      /**< ID_FS_VERSION */
+    QString fsLabel;        /**< ID_FS_LABEL */
+    QString fsUUID;         /**< ID_FS_UUID */
+    QString partEntryName;  /**< ID_PART_ENTRY_NAME */
+    QString partEntryUUID;  /**< ID_PART_ENTRY_UUID */
+    QString partEntryType;  /**< ID_PART_ENTRY_TYPE */
+    qint64 modified = -1;   /**< modification time of the udev database entry or -1 if unknown */
+    QHash<QString, QString> properties; /**< all ID_FS_*, ID_PART_*, ID_WWN and ID_SERIAL properties */
+};
+
+/** Cache of udev properties of block devices.
+
+    Entries are keyed by device node and device number. Properties are read directly
+    from the udev database in /run/udev/data and only if that fails from
+    udevadm info --query=property.
+*/
+class SfdiskProbeCache
+{
+public:
+    static SfdiskProbe probe(const QString& deviceNode);
+    static void prefetch(const QStringList& deviceNodes);
+    static void invalidate(const QString& deviceNode);
+    static void clear();
+};
+
+#endif
@@ -0,0 +1,242 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#include "plugins/sfdisk/sfdiskscancache.h"
+#include "plugins/sfdisk/sfdiskprobecache.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+static const quint32 snapshotMagic = 0x4b504d53; // "KPMS"
+static const quint32 snapshotVersion = 3;
+
+static QMutex cacheMutex;
+static QHash<QString, SfdiskDeviceSnapshot> snapshots; // keyed by snapshotKey()
+static bool loaded = false;
+static bool dirty = false;
+static int hitCount = 0;
+static int lookupCount = 0;
+
+static QDataStream& operator<<(QDataStream& stream, const SfdiskPartitionSnapshot& p)
+{
+    return stream << p.lastSector << p.modified << p.fileSystemType << p.label << p.uuid;
+}
+
+static QDataStream& operator>>(QDataStream& stream, SfdiskPartitionSnapshot& p)
+{
+    return stream >> p.lastSector >> p.modified >> p.fileSystemType >> p.label >> p.uuid;
+}
+
+static QDataStream& operator<<(QDataStream& stream, const SfdiskDeviceSnapshot& d)
+{
+    return stream << d.deviceNode << d.identity << d.size << d.generation << d.tableChecksum
+                  << d.name << d.icon << d.logicalSectorSize << d.partitions;
+}
+
+static QDataStream& operator>>(QDataStream& stream, SfdiskDeviceSnapshot& d)
+{
+    return stream >> d.deviceNode >> d.identity >> d.size >> d.generation >> d.tableChecksum
+                  >> d.name >> d.icon >> d.logicalSectorSize >> d.partitions;
+}
+
+static QString snapshotPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/kpmcore/scansnapshot");
+}
+
+/** Paths of a multipath disk share its WWN, so the device node is part of the key */
+static QString snapshotKey(const SfdiskDeviceSnapshot& snapshot)
+{
+    return snapshot.identity + QLatin1Char('@') + snapshot.deviceNode;
+}
+
+static QByteArray readSysfs(const QString& deviceName, const QString& attribute)
+{
+    QFile f(QStringLiteral("/sys/class/block/%1/%2").arg(deviceName, attribute));
+    if (!f.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    return f.readAll().trimmed();
+}
+
+static void load()
+{
+    if (loaded)
+        return;
+    loaded = true;
+
+    QFile file(snapshotPath());
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_10);
+
+    quint32 magic, version;
+    stream >> magic >> version;
+    if (magic != snapshotMagic || version != snapshotVersion)
+        return;
+
+    QHash<QString, SfdiskDeviceSnapshot> stored;
+    stream >> stored;
+    if (stream.status() == QDataStream::Ok)
+        snapshots = stored;
+}
+
+/** Collects the identity of a disk without running any external command.
+    @param deviceNode the device node (e.g. "/dev/sda")
+    @return a snapshot with only deviceNode, identity, size and generation set.
+            identity is empty if the disk has neither a WWN nor a serial number.
+*/
+SfdiskDeviceSnapshot SfdiskScanCache::identify(const QString& deviceNode)
+{
+    SfdiskDeviceSnapshot key;
+    key.deviceNode = deviceNode;
+
+    const SfdiskProbe probe = SfdiskProbeCache::probe(deviceNode);
+    if (!probe.valid || probe.modified == -1)
+        return key;
+
+    key.identity = probe.properties.value(QStringLiteral("ID_WWN"));
+    if (key.identity.isEmpty())
+        key.identity = probe.properties.value(QStringLiteral("ID_SERIAL"));
+
+    const QString deviceName = QFileInfo(deviceNode).fileName();
+    key.size = readSysfs(deviceName, QStringLiteral("size")).toLongLong() * 512;
+    key.generation = QString::fromLatin1(readSysfs(deviceName, QStringLiteral("diskseq"))) + QLatin1Char(':') + QString::number(probe.modified);
+
+    return key;
+}
+
+/** Looks up the snapshot of a disk.
+    @param key identity of the disk as returned by identify()
+    @param snapshot the stored snapshot if found
+    @return true if a snapshot with matching identity, device node, size and generation exists
+*/
+bool SfdiskScanCache::find(const SfdiskDeviceSnapshot& key, SfdiskDeviceSnapshot& snapshot)
+{
+    if (key.identity.isEmpty())
+        return false;
+
+    QMutexLocker locker(&cacheMutex);
+    load();
+
+    const auto it = snapshots.constFind(snapshotKey(key));
+    if (it == snapshots.constEnd() || it->size != key.size || it->generation != key.generation)
+        return false;
+
+    snapshot = *it;
+    return true;
+}
+
+/** Stores the snapshot of a disk. Call save() to write it to disk.
+    @param snapshot the snapshot; ignored if it has no identity
+*/
+void SfdiskScanCache::store(const SfdiskDeviceSnapshot& snapshot)
+{
+    if (snapshot.identity.isEmpty())
+        return;
+
+    QMutexLocker locker(&cacheMutex);
+    load();
+
+    snapshots.insert(snapshotKey(snapshot), snapshot);
+    dirty = true;
+}
+
+/** Drops the snapshot of the disk currently known under the given device node.
+    @param deviceNode the device node (e.g. "/dev/sda")
+*/
+void SfdiskScanCache::invalidate(const QString& deviceNode)
+{
+    QMutexLocker locker(&cacheMutex);
+    load();
+
+    for (auto it = snapshots.begin(); it != snapshots.end(); ) {
+        if (it->deviceNode == deviceNode) {
+            it = snapshots.erase(it);
+            dirty = true;
+        }
+        else
+            ++it;
+    }
+}
+
+/** Writes all snapshots to the cache file if anything changed.
+    @return true on success
+*/
+bool SfdiskScanCache::save()
+{
+    QMutexLocker locker(&cacheMutex);
+    if (!dirty)
+        return true;
+
+    const QString path = snapshotPath();
+    QDir().mkpath(QFileInfo(path).path());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_10);
+    stream << snapshotMagic << snapshotVersion << snapshots;
+
+    if (stream.status() != QDataStream::Ok || !file.commit())
+        return false;
+
+    dirty = false;
+    return true;
+}
+
+/** Records the outcome of restoring a disk from the cache.
+    @param hit true if the disk could be restored without rescanning
+*/
+void SfdiskScanCache::countLookup(bool hit)
+{
+    QMutexLocker locker(&cacheMutex);
+    ++lookupCount;
+    if (hit)
+        ++hitCount;
+}
+
+/** @return number of disks restored from the cache since the last resetStatistics() */
+int SfdiskScanCache::hits()
+{
+    QMutexLocker locker(&cacheMutex);
+    return hitCount;
+}
+
+/** @return number of disks looked up since the last resetStatistics() */
+int SfdiskScanCache::lookups()
+{
+    QMutexLocker locker(&cacheMutex);
+    return lookupCount;
+}
+
+void SfdiskScanCache::resetStatistics()
+{
+    QMutexLocker locker(&cacheMutex);
+    hitCount = 0;
+    lookupCount = 0;
+}
@@ -0,0 +1,85 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#if !defined(SFDISKSCANCACHE__H)
+
+#define SFDISKSCANCACHE__H
+
+#include <QHash>
+#include <QString>
+#include <QtGlobal>
+
+/** Scan results of a single Partition that are expensive to obtain */
+struct SfdiskPartitionSnapshot
+{
+    qint64 lastSector = -1;
+    qint64 modified = -1;       /**< timestamp of the partition's udev database entry */
+    qint32 fileSystemType = 0;
+    QString label;
+    QString uuid;
+};
+
+/** Snapshot of a scanned disk.
+
+    identity, deviceNode, size and generation identify the disk and its state;
+    tableChecksum guards the partitions, which are keyed by their first sector.
+    Each partition is only restored while its own udev database entry is unchanged.
+*/
+struct SfdiskDeviceSnapshot
+{
+    QString deviceNode;
+    QString identity;           /**< WWN or serial number */
+    qint64 size = -1;           /**< size in bytes */
+    QString generation;         /**< diskseq and udev database timestamp, both change on every boot */
+    quint32 tableChecksum = 0;  /**< CRC32 of the partition table as returned by SfdiskTableReader */
+
+    QString name;
+    QString icon;
+    qint64 logicalSectorSize = 0;
+    QHash<qint64, SfdiskPartitionSnapshot> partitions;
+};
+
+/** Persistent cache of scanned disks.
+
+    Snapshots are stored in a binary file in the user's cache directory so that
+    unchanged disks can be restored on the next start of an application without
+    running external tools for every partition.
+
+    The generation of a disk is taken from its diskseq and the timestamp of its
+    udev database entry. Both change whenever the disk or its partition table
+    change, but also on every boot, so the cache only helps within one boot.
+    Creating a file system or changing its label or UUID only updates the udev
+    entry of the partition, whose timestamp is therefore stored per partition.
+    File system usage is not cached because mounting and writing a file system
+    changes none of these.
+*/
+class SfdiskScanCache
+{
+public:
+    static SfdiskDeviceSnapshot identify(const QString& deviceNode);
+    static bool find(const SfdiskDeviceSnapshot& key, SfdiskDeviceSnapshot& snapshot);
+    static void store(const SfdiskDeviceSnapshot& snapshot);
+    static void invalidate(const QString& deviceNode);
+    static bool save();
+
+    static void countLookup(bool hit);
+    static int hits();
+    static int lookups();
+    static void resetStatistics();
+};
+
+#endif
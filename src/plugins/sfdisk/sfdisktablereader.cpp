@@ -0,0 +1,409 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#include "plugins/sfdisk/sfdisktablereader.h"
+
+#include "core/copysourcedevice.h"
+#include "core/copytargetbytearray.h"
+#include "core/device.h"
+
+#include "fs/byteorder.h"
+
+#include "util/externalcommand.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QSet>
+#include <QString>
+#include <QtEndian>
+
+#include <array>
+
+using FS::le16;
+using FS::le32;
+using FS::le64;
+
+namespace
+{
+constexpr qint64 gptDefaultEntriesSize = 128 * 128;
+constexpr qint64 gptMaxEntriesSize = 1024 * 1024;
+constexpr int ebrMaxChainLength = 1024;
+
+/** Formats a mixed-endian GUID the way sfdisk prints it */
+QString guidToString(const QByteArray& data, int offset)
+{
+    const uchar* p = reinterpret_cast<const uchar*>(data.constData() + offset);
+    QString guid = QStringLiteral("%1-%2-%3-")
+                    .arg(qFromLittleEndian<quint32>(p), 8, 16, QLatin1Char('0'))
+                    .arg(qFromLittleEndian<quint16>(p + 4), 4, 16, QLatin1Char('0'))
+                    .arg(qFromLittleEndian<quint16>(p + 6), 4, 16, QLatin1Char('0'));
+    for (int i = 8; i < 16; ++i) {
+        if (i == 10)
+            guid += QLatin1Char('-');
+        guid += QStringLiteral("%1").arg(p[i], 2, 16, QLatin1Char('0'));
+    }
+
+    return guid.toUpper();
+}
+
+bool isZero(const QByteArray& data, int offset, int size)
+{
+    for (int i = offset; i < offset + size; ++i)
+        if (data[i] != 0)
+            return false;
+
+    return true;
+}
+
+bool isExtended(quint8 type)
+{
+    return type == 0x05 || type == 0x0f || type == 0x85;
+}
+
+/** Checks for the BIOS parameter block of a FAT, exFAT or NTFS volume boot record, whose
+    boot code occupies the place of the partition table in an unpartitioned device */
+bool isVolumeBootRecord(const QByteArray& sector)
+{
+    const QByteArray oemName = sector.mid(3, 8);
+    if (oemName == QByteArrayLiteral("NTFS    ") || oemName == QByteArrayLiteral("EXFAT   "))
+        return true;
+
+    const quint8 jump = sector[0];
+    if (jump != 0xeb && jump != 0xe9)
+        return false;
+
+    const quint16 bytesPerSector = le16(sector, 11);
+    const quint8 sectorsPerCluster = sector[13];
+    const quint8 fatCount = sector[16];
+    const quint8 media = sector[21];
+    if (bytesPerSector < 512 || bytesPerSector > 4096 || (bytesPerSector & (bytesPerSector - 1)) != 0)
+        return false;
+    if (sectorsPerCluster == 0 || (sectorsPerCluster & (sectorsPerCluster - 1)) != 0)
+        return false;
+    if (le16(sector, 14) == 0 || fatCount == 0 || fatCount > 2 || (media != 0xf0 && media < 0xf8))
+        return false;
+
+    return sector.mid(54, 3) == QByteArrayLiteral("FAT") || sector.mid(82, 5) == QByteArrayLiteral("FAT32") ||
+           le16(sector, 22) != 0 || le32(sector, 36) != 0;
+}
+
+const std::array<std::array<quint32, 256>, 8>& crcTables()
+{
+    static const auto tables = [] {
+        std::array<std::array<quint32, 256>, 8> t;
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? (c >> 1) ^ 0xEDB88320 : c >> 1;
+            t[0][i] = c;
+        }
+        for (quint32 i = 0; i < 256; ++i)
+            for (int s = 1; s < 8; ++s)
+                t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xff];
+        return t;
+    }();
+
+    return tables;
+}
+}
+
+/** Creates a new reader
+    @param d the Device to read the partition table from
+*/
+SfdiskTableReader::SfdiskTableReader(Device& d) :
+    m_Device(d),
+    m_SectorSize(d.logicalSize()),
+    m_TotalSectors(0)
+{
+}
+
+/** @return the size of the device in logical sectors. Unlike Device::totalLogical() this is
+            not rounded down to a whole number of cylinders. */
+qint64 SfdiskTableReader::totalSectors()
+{
+    if (m_TotalSectors > 0)
+        return m_TotalSectors;
+
+    const QFileInfo node(m_Device.deviceNode());
+    if (node.isFile())
+        m_TotalSectors = node.size() / m_SectorSize;
+    else {
+        QFile sysfs(QStringLiteral("/sys/class/block/%1/size").arg(QFileInfo(node.canonicalFilePath()).fileName()));
+        if (sysfs.open(QIODevice::ReadOnly))
+            m_TotalSectors = sysfs.readAll().trimmed().toLongLong() * 512 / m_SectorSize;
+    }
+
+    if (m_TotalSectors <= 0)
+        m_TotalSectors = m_Device.totalLogical();
+
+    return m_TotalSectors;
+}
+
+/** Computes the CRC32 (as used by GPT) of a buffer.
+    Uses slicing-by-8 tables so that eight bytes are consumed per iteration.
+    @param data the data to checksum
+    @param size number of bytes
+    @return the CRC32
+*/
+quint32 SfdiskTableReader::crc32(const char* data, qint64 size)
+{
+    const auto& t = crcTables();
+    const uchar* p = reinterpret_cast<const uchar*>(data);
+    quint32 crc = 0xFFFFFFFF;
+
+    while (size >= 8) {
+        const quint32 one = qFromLittleEndian<quint32>(p) ^ crc;
+        const quint32 two = qFromLittleEndian<quint32>(p + 4);
+        crc = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^ t[5][(one >> 16) & 0xff] ^ t[4][one >> 24] ^
+              t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff] ^ t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+        p += 8;
+        size -= 8;
+    }
+
+    while (size-- > 0)
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+
+    return ~crc;
+}
+
+/** Reads the partition table.
+    @return partition table in the format of the "partitiontable" object of sfdisk --json
+            or an empty object if no valid GPT or MBR partition table was found
+*/
+QJsonObject SfdiskTableReader::read()
+{
+    if (m_SectorSize < 512)
+        return QJsonObject();
+
+    // MBR, GPT header and the usual 128 GPT entries in one read
+    const QByteArray sectors = readSectors(0, 2 + (gptDefaultEntriesSize + m_SectorSize - 1) / m_SectorSize);
+    if (sectors.size() < 2 * m_SectorSize)
+        return QJsonObject();
+
+    if (static_cast<quint8>(sectors[510]) != 0x55 || static_cast<quint8>(sectors[511]) != 0xaa)
+        return QJsonObject();
+
+    for (int i = 0; i < 4; ++i)
+        if (static_cast<quint8>(sectors[446 + 16 * i + 4]) == 0xee)
+            return readGpt(sectors);
+
+    // Leave anything that does not look like a sane MBR to sfdisk
+    if (isVolumeBootRecord(sectors))
+        return QJsonObject();
+
+    return readMbr(sectors.left(m_SectorSize));
+}
+
+QByteArray SfdiskTableReader::readSectors(qint64 firstSector, qint64 count)
+{
+    QByteArray buffer;
+    CopySourceDevice source(m_Device, firstSector * m_SectorSize, (firstSector + count) * m_SectorSize - 1);
+    CopyTargetByteArray target(buffer);
+
+    ExternalCommand copyCmd;
+    if (!copyCmd.copyBlocks(source, target))
+        return QByteArray();
+
+    return buffer;
+}
+
+QJsonObject SfdiskTableReader::readGpt(const QByteArray& sectors)
+{
+    const QByteArray header = sectors.mid(m_SectorSize, m_SectorSize);
+    const qint64 entriesLba = le64(header, 72);
+    const qint64 entriesSize = static_cast<qint64>(le32(header, 80)) * le32(header, 84);
+
+    // Entries are normally right behind the header and already read
+    QByteArray entries;
+    if (entriesLba == 2 && entriesSize <= sectors.size() - 2 * m_SectorSize)
+        entries = sectors.mid(2 * m_SectorSize);
+    else if (entriesLba > 1 && entriesSize > 0 && entriesSize <= gptMaxEntriesSize)
+        entries = readSectors(entriesLba, (entriesSize + m_SectorSize - 1) / m_SectorSize);
+
+    QJsonObject table = parseGpt(header, entries, 1, entriesLba);
+    if (!table.isEmpty())
+        return table;
+
+    // Primary GPT is damaged, try the backup at the end of the device
+    const qint64 lastLba = totalSectors() - 1;
+    const QByteArray backupHeader = readSectors(lastLba, 1);
+    if (backupHeader.size() != m_SectorSize)
+        return QJsonObject();
+
+    const qint64 backupEntriesLba = le64(backupHeader, 72);
+    const qint64 backupEntriesSize = static_cast<qint64>(le32(backupHeader, 80)) * le32(backupHeader, 84);
+    if (backupEntriesLba <= 1 || backupEntriesLba >= lastLba || backupEntriesSize <= 0 || backupEntriesSize > gptMaxEntriesSize)
+        return QJsonObject();
+
+    const QByteArray backupEntries = readSectors(backupEntriesLba, (backupEntriesSize + m_SectorSize - 1) / m_SectorSize);
+    return parseGpt(backupHeader, backupEntries, lastLba, backupEntriesLba);
+}
+
+QJsonObject SfdiskTableReader::parseGpt(const QByteArray& header, const QByteArray& entries, qint64 headerOffset, qint64 entriesOffset) const
+{
+    if (!header.startsWith(QByteArrayLiteral("EFI PART")))
+        return QJsonObject();
+
+    const quint32 headerSize = le32(header, 12);
+    if (headerSize < 92 || headerSize > static_cast<quint32>(header.size()))
+        return QJsonObject();
+
+    QByteArray headerCopy = header.left(headerSize);
+    const quint32 headerCrc = le32(header, 16);
+    qToLittleEndian<quint32>(0, reinterpret_cast<uchar*>(headerCopy.data() + 16));
+    if (crc32(headerCopy.constData(), headerSize) != headerCrc)
+        return QJsonObject();
+
+    if (static_cast<qint64>(le64(header, 24)) != headerOffset || static_cast<qint64>(le64(header, 72)) != entriesOffset)
+        return QJsonObject();
+
+    const quint32 entryCount = le32(header, 80);
+    const quint32 entrySize = le32(header, 84);
+    if (entrySize < 128 || static_cast<qint64>(entryCount) * entrySize > entries.size())
+        return QJsonObject();
+
+    if (crc32(entries.constData(), static_cast<qint64>(entryCount) * entrySize) != le32(header, 88))
+        return QJsonObject();
+
+    QJsonArray partitions;
+    for (quint32 i = 0; i < entryCount; ++i) {
+        const int offset = i * entrySize;
+        if (isZero(entries, offset, 16))
+            continue;
+
+        const qint64 first = le64(entries, offset + 32);
+        const qint64 last = le64(entries, offset + 40);
+
+        QString name;
+        for (int c = 0; c < 36; ++c) {
+            const quint16 ch = le16(entries, offset + 56 + 2 * c);
+            if (ch == 0)
+                break;
+            name += QChar(ch);
+        }
+
+        QJsonObject partition;
+        partition[QLatin1String("node")] = partitionNode(i + 1);
+        partition[QLatin1String("start")] = first;
+        partition[QLatin1String("size")] = last - first + 1;
+        partition[QLatin1String("type")] = guidToString(entries, offset);
+        partition[QLatin1String("uuid")] = guidToString(entries, offset + 16);
+        if (!name.isEmpty())
+            partition[QLatin1String("name")] = name;
+        partitions.append(partition);
+    }
+
+    QJsonObject table;
+    table[QLatin1String("label")] = QStringLiteral("gpt");
+    table[QLatin1String("id")] = guidToString(header, 56);
+    table[QLatin1String("device")] = m_Device.deviceNode();
+    table[QLatin1String("unit")] = QStringLiteral("sectors");
+    table[QLatin1String("firstlba")] = static_cast<qint64>(le64(header, 40));
+    table[QLatin1String("lastlba")] = static_cast<qint64>(le64(header, 48));
+    table[QLatin1String("maxentries")] = static_cast<qint64>(entryCount);
+    table[QLatin1String("partitions")] = partitions;
+
+    return table;
+}
+
+QJsonObject SfdiskTableReader::readMbr(const QByteArray& mbr)
+{
+    QJsonArray partitions;
+    QJsonArray logicalPartitions;
+
+    for (int i = 0; i < 4; ++i) {
+        const int offset = 446 + 16 * i;
+        const quint8 bootIndicator = mbr[offset];
+        if (bootIndicator != 0x00 && bootIndicator != 0x80)
+            return QJsonObject();
+
+        const qint64 start = le32(mbr, offset + 8);
+        const qint64 size = le32(mbr, offset + 12);
+        if (mbr[offset + 4] != 0 && size != 0 && (start == 0 || start + size > totalSectors()))
+            return QJsonObject();
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        const int offset = 446 + 16 * i;
+        const quint8 type = mbr[offset + 4];
+        const qint64 start = le32(mbr, offset + 8);
+        const qint64 size = le32(mbr, offset + 12);
+        if (type == 0 || size == 0)
+            continue;
+
+        QJsonObject partition;
+        partition[QLatin1String("node")] = partitionNode(i + 1);
+        partition[QLatin1String("start")] = start;
+        partition[QLatin1String("size")] = size;
+        partition[QLatin1String("type")] = QString::number(type, 16);
+        if (static_cast<quint8>(mbr[offset]) == 0x80)
+            partition[QLatin1String("bootable")] = true;
+        partitions.append(partition);
+
+        if (!isExtended(type) || !logicalPartitions.isEmpty())
+            continue;
+
+        // Follow the chain of extended boot records
+        QSet<qint64> visited;
+        qint64 ebrLba = start;
+        while (ebrLba > 0 && !visited.contains(ebrLba) && visited.size() < ebrMaxChainLength) {
+            visited.insert(ebrLba);
+            const QByteArray ebr = readSectors(ebrLba, 1);
+            if (ebr.size() < 512 || static_cast<quint8>(ebr[510]) != 0x55 || static_cast<quint8>(ebr[511]) != 0xaa)
+                break;
+
+            const quint8 logicalType = ebr[446 + 4];
+            const qint64 logicalSize = le32(ebr, 446 + 12);
+            if (logicalType != 0 && logicalSize != 0) {
+                QJsonObject logical;
+                logical[QLatin1String("node")] = partitionNode(5 + logicalPartitions.size());
+                logical[QLatin1String("start")] = ebrLba + le32(ebr, 446 + 8);
+                logical[QLatin1String("size")] = logicalSize;
+                logical[QLatin1String("type")] = QString::number(logicalType, 16);
+                if (static_cast<quint8>(ebr[446]) == 0x80)
+                    logical[QLatin1String("bootable")] = true;
+                logicalPartitions.append(logical);
+            }
+
+            const quint8 nextType = ebr[462 + 4];
+            ebrLba = isExtended(nextType) ? start + le32(ebr, 462 + 8) : 0;
+        }
+    }
+
+    for (const auto& logical : qAsConst(logicalPartitions))
+        partitions.append(logical);
+
+    QJsonObject table;
+    table[QLatin1String("label")] = QStringLiteral("dos");
+    table[QLatin1String("id")] = QStringLiteral("0x%1").arg(le32(mbr, 440), 8, 16, QLatin1Char('0'));
+    table[QLatin1String("device")] = m_Device.deviceNode();
+    table[QLatin1String("unit")] = QStringLiteral("sectors");
+    table[QLatin1String("partitions")] = partitions;
+
+    return table;
+}
+
+/** @return the device node of partition number, e.g. /dev/sda1 or /dev/nvme0n1p1 */
+QString SfdiskTableReader::partitionNode(int number) const
+{
+    const QString& deviceNode = m_Device.deviceNode();
+    if (!deviceNode.isEmpty() && deviceNode.back().isDigit())
+        return deviceNode + QLatin1Char('p') + QString::number(number);
+
+    return deviceNode + QString::number(number);
+}
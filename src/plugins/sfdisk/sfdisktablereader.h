@@ -0,0 +1,62 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#if !defined(SFDISKTABLEREADER__H)
+
+#define SFDISKTABLEREADER__H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QtGlobal>
+
+class Device;
+
+/** In-process reader of GPT and MBR partition tables.
+
+    Reads partition tables directly from the device and returns them in the same
+    format as the "partitiontable" object of sfdisk --json. GPT headers and entry
+    arrays are validated with CRC32; the backup GPT is used if the primary one is
+    damaged. Logical partitions are read by following the EBR chain. MBRs with invalid
+    boot indicators or partitions beyond the end of the device and volume boot records
+    of unpartitioned FAT or NTFS devices are left to sfdisk.
+*/
+class SfdiskTableReader
+{
+public:
+    explicit SfdiskTableReader(Device& d);
+
+public:
+    QJsonObject read();
+
+    static quint32 crc32(const char* data, qint64 size);
+
+protected:
+    virtual QByteArray readSectors(qint64 firstSector, qint64 count);
+
+private:
+    QJsonObject readGpt(const QByteArray& sectors);
+    QJsonObject parseGpt(const QByteArray& header, const QByteArray& entries, qint64 headerOffset, qint64 entriesOffset) const;
+    QJsonObject readMbr(const QByteArray& mbr);
+    QString partitionNode(int number) const;
+    qint64 totalSectors();
+
+    Device& m_Device;
+    qint64 m_SectorSize;
+    qint64 m_TotalSectors;
+};
+
+#endif
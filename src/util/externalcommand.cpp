@@ -29,17 +29,27 @@
 
 #include "externalcommandhelper_interface.h"
 
+#include <QCoreApplication>
 #include <QCryptographicHash>
+#include <QDBusArgument>
 #include <QDBusConnection>
 #include <QDBusInterface>
 #include <QDBusReply>
 #include <QEventLoop>
+#include <QFileInfo>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QScopedValueRollback>
 #include <QtGlobal>
 #include <QStandardPaths>
 #include <QString>
 #include <QStringList>
 #include <QTimer>
 #include <QThread>
+#include <QThreadPool>
 #include <QVariant>
 
 #include <KAuth>
@@ -54,14 +64,173 @@ struct ExternalCommandPrivate
     int m_ExitCode;
     QByteArray m_Output;
     QByteArray m_Input;
-    DBusThread *m_thread;
     QProcess::ProcessChannelMode processChannelMode;
 };
 
 KAuth::ExecuteJob* ExternalCommand::m_job;
-bool ExternalCommand::helperStarted = false;
+// Set on the thread running KAuth's event loop while the helper is started
+static thread_local bool startingHelper = false;
+QAtomicInt ExternalCommand::helperStarted = 0;
 QWidget* ExternalCommand::parent;
 
+/** Thread that registers our application interface on the system bus. Its event loop
+    also delivers replies of pending helper calls, so they complete even if the thread
+    that issued the call does not run an event loop.
+*/
+static DBusThread* dbusThread()
+{
+    static DBusThread* thread = [] () {
+        DBusThread* t = new DBusThread;
+        t->start();
+        return t;
+    }();
+
+    return thread;
+}
+
+/** The proxy of the KAuth helper shared by all ExternalCommand instances.
+    Proxy methods only compose a message and pass it on to QDBusConnection which is
+    thread-safe, so the same instance can be used from any thread.
+*/
+static org::kde::kpmcore::externalcommand* helperInterface()
+{
+    static org::kde::kpmcore::externalcommand* interface = [] () {
+        auto i = new org::kde::kpmcore::externalcommand(QStringLiteral("org.kde.kpmcore.externalcommand"),
+                    QStringLiteral("/Helper"), QDBusConnection::systemBus());
+        i->setTimeout(10 * 24 * 3600 * 1000); // 10 days
+        i->moveToThread(dbusThread());
+        return i;
+    }();
+
+    return interface;
+}
+
+/** Turns a pending helper call into a future.
+    @param pcall the pending call that returns either QVariantMap or bool
+    @return future that is finished once the helper has replied
+*/
+static QFuture<QVariantMap> watchReply(const QDBusPendingCall& pcall)
+{
+    QFutureInterface<QVariantMap> futureInterface;
+    futureInterface.reportStarted();
+
+    auto *watcher = new QDBusPendingCallWatcher(pcall);
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, [futureInterface] (QDBusPendingCallWatcher* watcher) mutable {
+        QVariantMap result;
+        if (watcher->isError())
+            qWarning() << watcher->error();
+        else {
+            const QVariant value = watcher->reply().arguments().value(0);
+            if (value.userType() == qMetaTypeId<QDBusArgument>())
+                result = qdbus_cast<QVariantMap>(value);
+            else
+                result[QStringLiteral("success")] = value.toBool();
+        }
+
+        futureInterface.reportResult(result);
+        futureInterface.reportFinished();
+        watcher->deleteLater();
+    });
+    watcher->moveToThread(dbusThread());
+
+    return futureInterface.future();
+}
+
+/** Checks whether a command only queries information that is readable without root.
+    Such commands are run directly instead of going through the helper, so read-only
+    consumers never have to wait for the helper to start or for authentication.
+    @param command full path of the command
+    @param args the arguments
+    @return true if the command may run unprivileged
+*/
+static bool isUnprivilegedQuery(const QString& command, const QStringList& args)
+{
+    const QString name = QFileInfo(command).fileName();
+    if (name == QStringLiteral("lsblk"))
+        return true;
+
+    if (name == QStringLiteral("udevadm"))
+        return args.value(0) == QStringLiteral("info") &&
+               !args.contains(QStringLiteral("--cleanup-db")) && !args.contains(QStringLiteral("-c"));
+
+    return false;
+}
+
+/** Runs an unprivileged query on the global thread pool, mirroring ExternalCommandHelper::start() */
+class UnprivilegedQuery : public QRunnable
+{
+public:
+    UnprivilegedQuery(const QString& command, const QStringList& args, const QByteArray& input, QProcess::ProcessChannelMode processChannelMode) :
+        m_Command(command),
+        m_Args(args),
+        m_Input(input),
+        m_ProcessChannelMode(processChannelMode)
+    {
+        m_FutureInterface.reportStarted();
+    }
+
+    QFuture<QVariantMap> future() {
+        return m_FutureInterface.future();
+    }
+
+    void run() override {
+        QProcess process;
+        process.setEnvironment( { QStringLiteral("LVM_SUPPRESS_FD_WARNINGS=1") } );
+        process.setProcessChannelMode(m_ProcessChannelMode);
+        process.start(m_Command, m_Args);
+        process.write(m_Input);
+        process.closeWriteChannel();
+
+        QVariantMap reply;
+        reply[QStringLiteral("success")] = process.waitForFinished(-1);
+        reply[QStringLiteral("output")] = process.readAllStandardOutput();
+        reply[QStringLiteral("exitCode")] = process.exitCode();
+
+        m_FutureInterface.reportResult(reply);
+        m_FutureInterface.reportFinished();
+    }
+
+private:
+    QString m_Command;
+    QStringList m_Args;
+    QByteArray m_Input;
+    QProcess::ProcessChannelMode m_ProcessChannelMode;
+    QFutureInterface<QVariantMap> m_FutureInterface;
+};
+
+/** @return a finished future holding a failed reply */
+static QFuture<QVariantMap> failedReply()
+{
+    QVariantMap reply;
+    reply[QStringLiteral("success")] = false;
+
+    QFutureInterface<QVariantMap> futureInterface;
+    futureInterface.reportStarted();
+    futureInterface.reportResult(reply);
+    futureInterface.reportFinished();
+    return futureInterface.future();
+}
+
+/** Waits until the helper has replied.
+    @param future the future returned by watchReply()
+    @param processEvents keep the event loop of the calling thread running (e.g. to forward progress signals)
+    @return the helper reply
+*/
+static QVariantMap waitForReply(const QFuture<QVariantMap>& future, bool processEvents)
+{
+    if (processEvents && !future.isFinished()) {
+        QEventLoop loop;
+        QFutureWatcher<QVariantMap> watcher;
+        QObject::connect(&watcher, &QFutureWatcher<QVariantMap>::finished, &loop, &QEventLoop::quit);
+        watcher.setFuture(future);
+        if (!future.isFinished())
+            loop.exec();
+    }
+
+    future.waitForFinished();
+    return future.result();
+}
+
 
 /** Creates a new ExternalCommand instance without Report.
     @param cmd the command to run
@@ -76,10 +245,7 @@ ExternalCommand::ExternalCommand(const QString& cmd, const QStringList& args, co
     d->m_ExitCode = -1;
     d->m_Output = QByteArray();
 
-    if (!helperStarted)
-        if(!startHelper())
-            Log(Log::Level::error) << xi18nc("@info:status", "Could not obtain administrator privileges.");
-
+    // The helper is only started once a command actually needs it
     d->processChannelMode = processChannelMode;
 }
 
@@ -124,14 +290,23 @@ bool ExternalCommand::start(int timeout)
     if (command().isEmpty())
         return false;
 
-    if (!QDBusConnection::systemBus().isConnected()) {
-        qWarning() << QDBusConnection::systemBus().lastError().message();
-        return false;
-    }
-
     if (report())
         report()->setCommand(xi18nc("@info:status", "Command: %1 %2", command(), args().join(QStringLiteral(" "))));
 
+    // Keep the event loop of a running application responsive, otherwise simply block.
+    const QVariantMap reply = waitForReply(startAsync(), QThread::currentThread()->loopLevel() > 0);
+
+    d->m_Output = reply[QStringLiteral("output")].toByteArray();
+    setExitCode(reply.contains(QStringLiteral("exitCode")) ? reply[QStringLiteral("exitCode")].toInt() : -1);
+
+    return reply[QStringLiteral("success")].toBool();
+}
+
+QFuture<QVariantMap> ExternalCommand::startAsync() const
+{
+    if (command().isEmpty())
+        return failedReply();
+
     if ( qEnvironmentVariableIsSet( "KPMCORE_DEBUG" ))
         qDebug() << xi18nc("@info:status", "Command: %1 %2", command(), args().join(QStringLiteral(" ")));
 
@@ -139,36 +314,134 @@ bool ExternalCommand::start(int timeout)
     if (cmd.isEmpty())
         cmd = QStandardPaths::findExecutable(command(), { QStringLiteral("/sbin/"), QStringLiteral("/usr/sbin/"), QStringLiteral("/usr/local/sbin/") });
 
-    auto *interface = new org::kde::kpmcore::externalcommand(QStringLiteral("org.kde.kpmcore.externalcommand"),
-                    QStringLiteral("/Helper"), QDBusConnection::systemBus(), this);
+    if (!cmd.isEmpty() && isUnprivilegedQuery(cmd, args())) {
+        UnprivilegedQuery* query = new UnprivilegedQuery(cmd, args(), d->m_Input, d->processChannelMode);
+        QFuture<QVariantMap> future = query->future();
+        QThreadPool::globalInstance()->start(query);
+        return future;
+    }
 
-    interface->setTimeout(10 * 24 * 3600 * 1000); // 10 days
+    if (!QDBusConnection::systemBus().isConnected()) {
+        qWarning() << QDBusConnection::systemBus().lastError().message();
+        return failedReply();
+    }
 
-    bool rval = false;
+    if (!ensureHelperStarted()) {
+        Log(Log::Level::error) << xi18nc("@info:status", "Could not obtain administrator privileges.");
+        return failedReply();
+    }
 
-    QDBusPendingCall pcall = interface->start(cmd, args(), d->m_Input, d->processChannelMode);
+    return watchReply(helperInterface()->start(cmd, args(), d->m_Input, d->processChannelMode));
+}
 
-    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(pcall, this);
-    QEventLoop loop;
+bool ExternalCommand::runBatch(const QList<ExternalCommand*>& commands, int parallelism)
+{
+    if (commands.isEmpty())
+        return true;
+
+    const bool processEvents = QThread::currentThread()->loopLevel() > 0;
+
+    // Unprivileged queries run locally, only the remaining commands go through the helper
+    QList<ExternalCommand*> localCommands;
+    QList<QFuture<QVariantMap>> localReplies;
+    QList<ExternalCommand*> helperCommands;
+    QVariantList batch;
+    for (ExternalCommand* command : commands) {
+        if (command->report())
+            command->report()->setCommand(xi18nc("@info:status", "Command: %1 %2", command->command(), command->args().join(QStringLiteral(" "))));
+
+        if ( qEnvironmentVariableIsSet( "KPMCORE_DEBUG" ))
+            qDebug() << xi18nc("@info:status", "Command: %1 %2", command->command(), command->args().join(QStringLiteral(" ")));
+
+        QString cmd = QStandardPaths::findExecutable(command->command());
+        if (cmd.isEmpty())
+            cmd = QStandardPaths::findExecutable(command->command(), { QStringLiteral("/sbin/"), QStringLiteral("/usr/sbin/"), QStringLiteral("/usr/local/sbin/") });
+
+        if (!cmd.isEmpty() && isUnprivilegedQuery(cmd, command->args())) {
+            UnprivilegedQuery* query = new UnprivilegedQuery(cmd, command->args(), command->d->m_Input, command->d->processChannelMode);
+            localCommands.append(command);
+            localReplies.append(query->future());
+            QThreadPool::globalInstance()->start(query);
+            continue;
+        }
 
-    auto exitLoop = [&] (QDBusPendingCallWatcher *watcher) {
-        loop.exit();
+        QVariantMap entry;
+        entry[QStringLiteral("command")] = cmd;
+        entry[QStringLiteral("arguments")] = command->args();
+        entry[QStringLiteral("input")] = command->d->m_Input;
+        entry[QStringLiteral("processChannelMode")] = static_cast<int>(command->d->processChannelMode);
+        helperCommands.append(command);
+        batch.append(entry);
+    }
 
-        if (watcher->isError())
-            qWarning() << watcher->error();
+    bool success = true;
+    if (!helperCommands.isEmpty()) {
+        if (!QDBusConnection::systemBus().isConnected()) {
+            qWarning() << QDBusConnection::systemBus().lastError().message();
+            success = false;
+        }
+        else if (!ensureHelperStarted())
+            success = false;
         else {
-            QDBusPendingReply<QVariantMap> reply = *watcher;
-
-            d->m_Output = reply.value()[QStringLiteral("output")].toByteArray();
-            setExitCode(reply.value()[QStringLiteral("exitCode")].toInt());
-            rval = reply.value()[QStringLiteral("success")].toBool();
+            QDBusPendingCall pcall = helperInterface()->startBatch(batch, parallelism);
+            const QVariantMap reply = waitForReply(watchReply(pcall), processEvents);
+
+            const QVariantList results = qdbus_cast<QVariantList>(reply[QStringLiteral("results")]);
+            success = reply[QStringLiteral("success")].toBool() && results.size() == helperCommands.size();
+            for (int i = 0; success && i < helperCommands.size(); ++i) {
+                const QVariantMap result = qdbus_cast<QVariantMap>(results.value(i));
+                helperCommands[i]->d->m_Output = result[QStringLiteral("output")].toByteArray();
+                helperCommands[i]->setExitCode(result.contains(QStringLiteral("exitCode")) ? result[QStringLiteral("exitCode")].toInt() : -1);
+            }
         }
-    };
+    }
 
-    connect(watcher, &QDBusPendingCallWatcher::finished, exitLoop);
-    loop.exec();
+    // Local queries are always waited for, their runnables report to the futures
+    for (int i = 0; i < localCommands.size(); ++i) {
+        const QVariantMap result = waitForReply(localReplies[i], processEvents);
+        localCommands[i]->d->m_Output = result[QStringLiteral("output")].toByteArray();
+        localCommands[i]->setExitCode(result.contains(QStringLiteral("exitCode")) ? result[QStringLiteral("exitCode")].toInt() : -1);
+        success = success && result[QStringLiteral("success")].toBool();
+    }
 
-    return rval;
+    return success;
+}
+
+bool ExternalCommand::readData(const QString& deviceNode, qint64 firstByte, qint64 length, QByteArray& buffer)
+{
+    buffer = readData(deviceNode, { qMakePair(firstByte, length) }).value(0);
+    return buffer.size() == length;
+}
+
+QList<QByteArray> ExternalCommand::readData(const QString& deviceNode, const QList<QPair<qint64, qint64>>& ranges)
+{
+    QList<QByteArray> data;
+    if (!QDBusConnection::systemBus().isConnected()) {
+        qWarning() << QDBusConnection::systemBus().lastError().message();
+        return data;
+    }
+
+    if (!ensureHelperStarted())
+        return data;
+
+    QVariantList rangeList;
+    for (const auto& range : ranges) {
+        QVariantMap entry;
+        entry[QStringLiteral("offset")] = range.first;
+        entry[QStringLiteral("size")] = range.second;
+        rangeList.append(entry);
+    }
+
+    QDBusPendingCall pcall = helperInterface()->readBytes(deviceNode, rangeList);
+    const QVariantMap reply = waitForReply(watchReply(pcall), QThread::currentThread()->loopLevel() > 0);
+    if (!reply[QStringLiteral("success")].toBool())
+        return data;
+
+    const QVariantList results = qdbus_cast<QVariantList>(reply[QStringLiteral("data")]);
+    for (const QVariant& result : results)
+        data.append(result.toByteArray());
+
+    return data;
 }
 
 bool ExternalCommand::copyBlocks(const CopySource& source, CopyTarget& target)
@@ -181,37 +454,25 @@ bool ExternalCommand::copyBlocks(const CopySource& source, CopyTarget& target)
         return false;
     }
 
+    if (!ensureHelperStarted())
+        return false;
+
     // TODO KF6:Use new signal-slot syntax
     connect(m_job, SIGNAL(percent(KJob*, unsigned long)), this, SLOT(emitProgress(KJob*, unsigned long)));
     connect(m_job, &KAuth::ExecuteJob::newData, this, &ExternalCommand::emitReport);
 
-    auto *interface = new org::kde::kpmcore::externalcommand(QStringLiteral("org.kde.kpmcore.externalcommand"),
-                QStringLiteral("/Helper"), QDBusConnection::systemBus(), this);
-    interface->setTimeout(10 * 24 * 3600 * 1000); // 10 days
-
-    QDBusPendingCall pcall = interface->copyblocks(source.path(), source.firstByte(), source.length(),
-                                                   target.path(), target.firstByte(), blockSize);
-
-    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(pcall, this);
-    QEventLoop loop;
+    QDBusPendingCall pcall = helperInterface()->copyblocks(source.path(), source.firstByte(), source.length(),
+                                                           target.path(), target.firstByte(), blockSize);
 
-    auto exitLoop = [&] (QDBusPendingCallWatcher *watcher) {
-        loop.exit();
-        if (watcher->isError())
-            qWarning() << watcher->error();
-        else {
-            QDBusPendingReply<QVariantMap> reply = *watcher;
-            rval = reply.value()[QStringLiteral("success")].toBool();
+    // Progress is delivered through KAuth signals, so keep processing events while waiting
+    const QVariantMap reply = waitForReply(watchReply(pcall), true);
+    rval = reply[QStringLiteral("success")].toBool();
 
-            CopyTargetByteArray *byteArrayTarget = dynamic_cast<CopyTargetByteArray*>(&target);
-            if (byteArrayTarget)
-                byteArrayTarget->m_Array = reply.value()[QStringLiteral("targetByteArray")].toByteArray();
-        }
-        setExitCode(!rval);
-    };
+    CopyTargetByteArray *byteArrayTarget = dynamic_cast<CopyTargetByteArray*>(&target);
+    if (rval && byteArrayTarget)
+        byteArrayTarget->m_Array = reply[QStringLiteral("targetByteArray")].toByteArray();
 
-    connect(watcher, &QDBusPendingCallWatcher::finished, exitLoop);
-    loop.exec();
+    setExitCode(!rval);
 
     return rval;
 }
@@ -229,28 +490,12 @@ bool ExternalCommand::writeData(Report& commandReport, const QByteArray& buffer,
         return false;
     }
 
-    auto *interface = new org::kde::kpmcore::externalcommand(QStringLiteral("org.kde.kpmcore.externalcommand"),
-                QStringLiteral("/Helper"), QDBusConnection::systemBus(), this);
-    interface->setTimeout(10 * 24 * 3600 * 1000); // 10 days
- 
-    QDBusPendingCall pcall = interface->writeData(buffer, deviceNode, firstByte);
-
-    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(pcall, this);
-    QEventLoop loop;
-
-    auto exitLoop = [&] (QDBusPendingCallWatcher *watcher) {
-        loop.exit();
-        if (watcher->isError())
-            qWarning() << watcher->error();
-        else {
-            QDBusPendingReply<bool> reply = *watcher;
-            rval = reply.argumentAt<0>();
-        }
-        setExitCode(!rval);
-    };
+    if (!ensureHelperStarted())
+        return false;
 
-    connect(watcher, &QDBusPendingCallWatcher::finished, exitLoop);
-    loop.exec();
+    QDBusPendingCall pcall = helperInterface()->writeData(buffer, deviceNode, firstByte);
+    rval = waitForReply(watchReply(pcall), false)[QStringLiteral("success")].toBool();
+    setExitCode(!rval);
 
     return rval;
 }
@@ -341,18 +586,87 @@ void ExternalCommand::setExitCode(int i)
 
 bool ExternalCommand::startHelper()
 {
+    return ensureHelperStarted();
+}
+
+/** Starts the KAuth helper unless it is already running.
+    Concurrent callers wait until the first one has finished starting the helper. The lock
+    is not held while KAuth runs its event loop; calls made from that loop fail at once,
+    because the helper cannot finish starting before the loop returns.
+    @return true if the helper is running
+*/
+bool ExternalCommand::ensureHelperStarted()
+{
+    if (helperStarted.loadAcquire())
+        return true;
+
+    if (startingHelper) {
+        qWarning() << "helper requested while it is being started";
+        return false;
+    }
+
+    static QMutex mutex;
+    static QFutureInterface<QVariantMap> starting;
+    static bool startRequested = false;
+    {
+        QMutexLocker locker(&mutex);
+        if (helperStarted.loadAcquire())
+            return true;
+
+        if (startRequested) {
+            const QFuture<QVariantMap> future = starting.future();
+            locker.unlock();
+            return waitForReply(future, QThread::currentThread()->loopLevel() > 0)[QStringLiteral("success")].toBool();
+        }
+
+        startRequested = true;
+        starting.reportStarted();
+    }
+
+    const bool started = doStartHelper();
+
+    QVariantMap reply;
+    reply[QStringLiteral("success")] = started;
+
+    QMutexLocker locker(&mutex);
+    starting.reportResult(reply);
+    starting.reportFinished();
+    if (!started) {
+        // Let the next caller try again
+        starting = QFutureInterface<QVariantMap>();
+        startRequested = false;
+    }
+
+    return started;
+}
+
+/** Starts the KAuth helper and waits until it is ready, see ensureHelperStarted().
+    KAuth and the authentication dialog must be used from the GUI thread, so calls from
+    other threads are run there and block until the helper has started.
+    @return true if the helper is running
+*/
+bool ExternalCommand::doStartHelper()
+{
+    QCoreApplication* application = QCoreApplication::instance();
+    if (application && QThread::currentThread() != application->thread()) {
+        bool started = false;
+        QMetaObject::invokeMethod(application, [&started] () { started = doStartHelper(); }, Qt::BlockingQueuedConnection);
+        return started;
+    }
+
+    const QScopedValueRollback<bool> guard(startingHelper, true);
+
     if (!QDBusConnection::systemBus().isConnected()) {
         qWarning() << QDBusConnection::systemBus().lastError().message();
         return false;
     }
-    
+
     QDBusInterface iface(QStringLiteral("org.kde.kpmcore.helperinterface"), QStringLiteral("/Helper"), QStringLiteral("org.kde.kpmcore.externalcommand"), QDBusConnection::systemBus());
     if (iface.isValid()) {
         exit(0);
     }
 
-    d->m_thread = new DBusThread;
-    d->m_thread->start();
+    dbusThread();
 
     KAuth::Action action = KAuth::Action(QStringLiteral("org.kde.kpmcore.externalcommand.init"));
     action.setHelperId(QStringLiteral("org.kde.kpmcore.externalcommand"));
@@ -365,22 +679,23 @@ bool ExternalCommand::startHelper()
 
     // Wait until ExternalCommand Helper is ready (helper sends newData signal just before it enters event loop)
     QEventLoop loop;
-    auto exitLoop = [&] () { loop.exit(); };
-    auto conn = QObject::connect(m_job, &KAuth::ExecuteJob::newData, exitLoop);
-    QObject::connect(m_job, &KJob::finished, [=] () { if(m_job->error()) exitLoop(); } );
+    QObject::connect(m_job, &KAuth::ExecuteJob::newData, &loop, [&loop] () { loop.exit(); });
+    QObject::connect(m_job, &KJob::finished, &loop, [&loop] () { if (m_job->error()) loop.exit(); });
     loop.exec();
-    QObject::disconnect(conn);
 
-    helperStarted = true;
+    if (m_job->error()) {
+        qWarning() << m_job->errorString();
+        return false;
+    }
+
+    helperStarted.storeRelease(1);
     return true;
 }
 
 void ExternalCommand::stopHelper()
 {
-    auto *interface = new org::kde::kpmcore::externalcommand(QStringLiteral("org.kde.kpmcore.externalcommand"),
-                                                             QStringLiteral("/Helper"), QDBusConnection::systemBus());
-    interface->exit();
-
+    if (helperStarted.loadAcquire())
+        helperInterface()->exit();
 }
 
 void DBusThread::run()
@@ -388,9 +703,9 @@ void DBusThread::run()
     if (!QDBusConnection::systemBus().registerService(QStringLiteral("org.kde.kpmcore.applicationinterface")) || 
         !QDBusConnection::systemBus().registerObject(QStringLiteral("/Application"), this, QDBusConnection::ExportAllSlots)) {
         qWarning() << QDBusConnection::systemBus().lastError().message();
-        return;
     }
-        
+
+    // Pending helper calls are also finished from this event loop
     QEventLoop loop;
     loop.exec();
 }
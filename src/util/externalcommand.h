@@ -21,7 +21,11 @@
 
 #include "util/libpartitionmanagerexport.h"
 
+#include <QAtomicInt>
 #include <QDebug>
+#include <QFuture>
+#include <QList>
+#include <QPair>
 #include <QProcess>
 #include <QString>
 #include <QStringList>
@@ -91,6 +95,37 @@ public:
     bool start(int timeout = 30000);
     bool run(int timeout = 30000);
 
+    /**< Asynchronously executes the command.
+     * The returned future does not reference this object, so it may be destroyed before the command finishes.
+     * @return future holding the helper reply ("success", "exitCode" and "output")
+     */
+    QFuture<QVariantMap> startAsync() const;
+
+    /**< Runs several commands with a single helper call.
+     * Queries that do not need root (lsblk, udevadm info) run locally instead.
+     * Output and exit code of every command are stored in the respective ExternalCommand.
+     * @param commands the commands to run
+     * @param parallelism maximum number of commands the helper runs at the same time
+     * @return true if the whole batch was run
+     */
+    static bool runBatch(const QList<ExternalCommand*>& commands, int parallelism = 4);
+
+    /**< Reads a small range of a device, e.g. a file system superblock, through the helper.
+     * @param deviceNode the device node or image file to read from
+     * @param firstByte offset of the first byte to read
+     * @param length number of bytes to read
+     * @param buffer receives the data
+     * @return true if all bytes were read
+     */
+    static bool readData(const QString& deviceNode, qint64 firstByte, qint64 length, QByteArray& buffer);
+
+    /**< Reads several small ranges of a device with a single helper call.
+     * @param deviceNode the device node or image file to read from
+     * @param ranges offset and length in bytes of each range
+     * @return the data of each range, empty for ranges that could not be read
+     */
+    static QList<QByteArray> readData(const QString& deviceNode, const QList<QPair<qint64, qint64>>& ranges);
+
     /**< @return the exit code */
     int exitCode() const;
 
@@ -129,12 +164,15 @@ private:
     void setExitCode(int i);
     void onReadOutput();
 
+    static bool ensureHelperStarted();
+    static bool doStartHelper();
+
 private:
     std::unique_ptr<ExternalCommandPrivate> d;
 
     // KAuth
     static KAuth::ExecuteJob *m_job;
-    static bool helperStarted;
+    static QAtomicInt helperStarted;
     static QWidget *parent;
 };
 
@@ -28,6 +28,8 @@
 
 #include <KLocalizedString>
 
+#include <vector>
+
 /** Initialize ExternalCommandHelper Daemon and prepare DBus interface
  *
  * KAuth helper runs in the background until application exits.
@@ -146,6 +148,46 @@ bool ExternalCommandHelper::writeData(const QString &targetDevice, const QByteAr
     return true;
 }
 
+/** Reads several small ranges of a device or file, e.g. file system superblocks.
+    @param sourceDevice device or file to read from
+    @param ranges list of maps with "offset" and "size" in bytes
+    @return map with "success" and "data", the bytes read for each range; ranges
+            that could not be read completely give an empty byte array
+*/
+QVariantMap ExternalCommandHelper::readBytes(const QString& sourceDevice, const QVariantList& ranges)
+{
+    // Keeps replies well below the D-Bus message size limit of the system bus
+    const qint64 maxRangeSize = 16 * 1024 * 1024;
+
+    QVariantMap reply;
+    QVariantList data;
+
+    QFile device(sourceDevice);
+    if (!device.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        qCritical() << xi18n("Could not open device <filename>%1</filename> for reading.", sourceDevice);
+        reply[QStringLiteral("success")] = false;
+        return reply;
+    }
+
+    for (const QVariant& range : ranges) {
+        const QVariantMap entry = qdbus_cast<QVariantMap>(range);
+        const qint64 offset = entry[QStringLiteral("offset")].toLongLong();
+        const qint64 size = entry[QStringLiteral("size")].toLongLong();
+
+        QByteArray buffer;
+        if (offset >= 0 && size > 0 && size <= maxRangeSize && device.seek(offset)) {
+            buffer = device.read(size);
+            if (buffer.size() != size)
+                buffer.clear();
+        }
+        data.append(buffer);
+    }
+
+    reply[QStringLiteral("success")] = true;
+    reply[QStringLiteral("data")] = data;
+    return reply;
+}
+
 // If targetDevice is empty then return QByteArray with data that was read from disk.
 QVariantMap ExternalCommandHelper::copyblocks(const QString& sourceDevice, const qint64 sourceFirstByte, const qint64 sourceLength, const QString& targetDevice, const qint64 targetFirstByte, const qint64 blockSize)
 {
@@ -257,30 +299,96 @@ QVariantMap ExternalCommandHelper::start(const QString& command, const QStringLi
         return reply;
     }
 
-    // Compare with command whitelist
-    QString basename = command.mid(command.lastIndexOf(QLatin1Char('/')) + 1);
-    if (std::find(std::begin(allowedCommands), std::end(allowedCommands), basename) == std::end(allowedCommands)) {
-        qInfo() << command <<" command is not one of the whitelisted command";
-        m_loop->exit();
+    if (!isAllowed(command)) {
         reply[QStringLiteral("success")] = false;
         return reply;
     }
 
 //  connect(&cmd, &QProcess::readyReadStandardOutput, this, &ExternalCommandHelper::onReadOutput);
 
-    m_cmd.setEnvironment( { QStringLiteral("LVM_SUPPRESS_FD_WARNINGS=1") } );
-    m_cmd.setProcessChannelMode(static_cast<QProcess::ProcessChannelMode>(processChannelMode));
-    m_cmd.start(command, arguments);
-    m_cmd.write(input);
-    m_cmd.closeWriteChannel();
-    m_cmd.waitForFinished(-1);
-    QByteArray output = m_cmd.readAllStandardOutput();
-    reply[QStringLiteral("output")] = output;
-    reply[QStringLiteral("exitCode")] = m_cmd.exitCode();
+    startProcess(m_cmd, command, arguments, input, processChannelMode);
+    reply.unite(finishProcess(m_cmd));
 
     return reply;
 }
 
+/** Runs a batch of commands and returns all their results at once.
+    @param commands list of maps with "command", "arguments", "input" and "processChannelMode" entries
+    @param parallelism maximum number of commands running at the same time
+    @return map with "success" and "results", a list of maps with "output" and "exitCode" in the order of commands
+*/
+QVariantMap ExternalCommandHelper::startBatch(const QVariantList& commands, const int parallelism)
+{
+    QTextCodec::setCodecForLocale(QTextCodec::codecForName("UTF-8"));
+    QVariantMap reply;
+    reply[QStringLiteral("success")] = true;
+
+    // Validate the whole batch before running anything
+    QList<QVariantMap> entries;
+    for (const QVariant& command : commands) {
+        const QVariantMap entry = qdbus_cast<QVariantMap>(command);
+        if (entry[QStringLiteral("command")].toString().isEmpty() || !isAllowed(entry[QStringLiteral("command")].toString())) {
+            reply[QStringLiteral("success")] = false;
+            return reply;
+        }
+        entries.append(entry);
+    }
+
+    const int maxRunning = qMax(1, parallelism);
+    std::vector<std::unique_ptr<QProcess>> processes;
+    QVariantList results;
+    for (const auto& entry : qAsConst(entries)) {
+        if (processes.size() - results.size() >= static_cast<size_t>(maxRunning))
+            results.append(finishProcess(*processes[results.size()]));
+
+        processes.push_back(std::make_unique<QProcess>());
+        startProcess(*processes.back(), entry[QStringLiteral("command")].toString(), entry[QStringLiteral("arguments")].toStringList(),
+                     entry[QStringLiteral("input")].toByteArray(), entry[QStringLiteral("processChannelMode")].toInt());
+    }
+
+    while (results.size() < entries.size())
+        results.append(finishProcess(*processes[results.size()]));
+
+    reply[QStringLiteral("results")] = results;
+    return reply;
+}
+
+/** Compares the command with the whitelist.
+    The helper exits if it is asked to run a command that is not whitelisted.
+    @param command the command to check
+    @return true if the command may be run
+*/
+bool ExternalCommandHelper::isAllowed(const QString& command)
+{
+    QString basename = command.mid(command.lastIndexOf(QLatin1Char('/')) + 1);
+    if (std::find(std::begin(allowedCommands), std::end(allowedCommands), basename) == std::end(allowedCommands)) {
+        qInfo() << command <<" command is not one of the whitelisted command";
+        m_loop->exit();
+        return false;
+    }
+
+    return true;
+}
+
+void ExternalCommandHelper::startProcess(QProcess& process, const QString& command, const QStringList& arguments, const QByteArray& input, const int processChannelMode)
+{
+    process.setEnvironment( { QStringLiteral("LVM_SUPPRESS_FD_WARNINGS=1") } );
+    process.setProcessChannelMode(static_cast<QProcess::ProcessChannelMode>(processChannelMode));
+    process.start(command, arguments);
+    process.write(input);
+    process.closeWriteChannel();
+}
+
+QVariantMap ExternalCommandHelper::finishProcess(QProcess& process)
+{
+    QVariantMap result;
+    process.waitForFinished(-1);
+    result[QStringLiteral("output")] = process.readAllStandardOutput();
+    result[QStringLiteral("exitCode")] = process.exitCode();
+
+    return result;
+}
+
 void ExternalCommandHelper::exit()
 {
     m_loop->exit();
@@ -45,12 +45,17 @@ public:
 public Q_SLOTS:
     ActionReply init(const QVariantMap& args);
     Q_SCRIPTABLE QVariantMap start(const QString& command, const QStringList& arguments, const QByteArray& input, const int processChannelMode);
+    Q_SCRIPTABLE QVariantMap startBatch(const QVariantList& commands, const int parallelism);
+    Q_SCRIPTABLE QVariantMap readBytes(const QString& sourceDevice, const QVariantList& ranges);
     Q_SCRIPTABLE QVariantMap copyblocks(const QString& sourceDevice, const qint64 sourceFirstByte, const qint64 sourceLength, const QString& targetDevice, const qint64 targetFirstByte, const qint64 blockSize);
     Q_SCRIPTABLE bool writeData(const QByteArray& buffer, const QString& targetDevice, const qint64 targetFirstByte);
     Q_SCRIPTABLE void exit();
 
 private:
     void onReadOutput();
+    bool isAllowed(const QString& command);
+    static void startProcess(QProcess& process, const QString& command, const QStringList& arguments, const QByteArray& input, const int processChannelMode);
+    static QVariantMap finishProcess(QProcess& process);
 
     std::unique_ptr<QEventLoop> m_loop;
     QProcess m_cmd;
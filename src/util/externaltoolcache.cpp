@@ -0,0 +1,261 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#include "util/externaltoolcache.h"
+#include "util/externalcommand.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+struct ToolProbe
+{
+    QString path;
+    QStringList args;
+    qint64 modified = 0;
+    qint64 size = 0;
+    int exitCode = -1;
+    QString output;
+};
+
+static const quint32 cacheMagic = 0x4b504d54; // "KPMT"
+static const quint32 cacheVersion = 1;
+
+static QMutex cacheMutex(QMutex::Recursive);
+static QByteArray resolvedPath;                 // PATH the resolved executables belong to
+static QHash<QString, QString> resolved;        // keyed by command name, empty if not found
+static QHash<QString, ToolProbe> probes;        // keyed by probeKey()
+static QList<QStringList> collected;            // command name followed by arguments
+static bool collecting = false;
+static bool loaded = false;
+static bool dirty = false;
+
+static QDataStream& operator<<(QDataStream& stream, const ToolProbe& p)
+{
+    return stream << p.path << p.args << p.modified << p.size << p.exitCode << p.output;
+}
+
+static QDataStream& operator>>(QDataStream& stream, ToolProbe& p)
+{
+    return stream >> p.path >> p.args >> p.modified >> p.size >> p.exitCode >> p.output;
+}
+
+static QString cachePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/kpmcore/toolprobes");
+}
+
+static QString probeKey(const QString& path, const QStringList& args)
+{
+    return QStringList(path + args).join(QChar(0x1f));
+}
+
+/** @return true if the executable was not replaced since the probe was run */
+static bool isCurrent(const ToolProbe& p)
+{
+    const QFileInfo info(p.path);
+    return info.exists() && info.lastModified().toMSecsSinceEpoch() == p.modified && info.size() == p.size;
+}
+
+static void load()
+{
+    if (loaded)
+        return;
+    loaded = true;
+
+    QFile file(cachePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    quint32 magic, version;
+    stream >> magic >> version;
+    if (magic != cacheMagic || version != cacheVersion)
+        return;
+
+    QHash<QString, ToolProbe> stored;
+    stream >> stored;
+    if (stream.status() != QDataStream::Ok)
+        return;
+
+    for (auto it = stored.constBegin(); it != stored.constEnd(); ++it)
+        if (isCurrent(*it))
+            probes.insert(it.key(), *it);
+}
+
+/** Finds an executable in PATH or in the usual sbin directories without running it.
+    @param cmdName the command name (e.g. "mkfs.ext4")
+    @return the full path of the executable, empty if it was not found
+*/
+QString ExternalToolCache::resolve(const QString& cmdName)
+{
+    QMutexLocker locker(&cacheMutex);
+
+    const QByteArray path = qgetenv("PATH");
+    if (path != resolvedPath) {
+        resolved.clear();
+        resolvedPath = path;
+    }
+
+    const auto it = resolved.constFind(cmdName);
+    if (it != resolved.constEnd())
+        return *it;
+
+    QString cmdFullPath = QStandardPaths::findExecutable(cmdName);
+    if (cmdFullPath.isEmpty())
+        cmdFullPath = QStandardPaths::findExecutable(cmdName, { QStringLiteral("/sbin/"), QStringLiteral("/usr/sbin/"), QStringLiteral("/usr/local/sbin/") });
+
+    resolved.insert(cmdName, cmdFullPath);
+    return cmdFullPath;
+}
+
+/** Runs a probe on a tool or returns its cached result.
+
+    While collecting, probes missing from the cache are not run but queued for runCollected().
+
+    @param cmdName the command name (e.g. "mkfs.btrfs")
+    @param args the arguments of the probe
+    @param exitCode set to the exit code of the probe
+    @param output set to the output of the probe
+    @return true if the probe was run
+*/
+bool ExternalToolCache::probe(const QString& cmdName, const QStringList& args, int& exitCode, QString& output)
+{
+    QMutexLocker locker(&cacheMutex);
+    load();
+
+    const QString path = resolve(cmdName);
+    if (path.isEmpty())
+        return false;
+
+    const QString key = probeKey(path, args);
+    auto it = probes.constFind(key);
+    if (it != probes.constEnd() && !isCurrent(*it)) {
+        probes.remove(key);
+        it = probes.constEnd();
+        dirty = true;
+    }
+
+    if (it == probes.constEnd()) {
+        if (collecting) {
+            collected.append(QStringList(cmdName) + args);
+            return false;
+        }
+
+        ExternalCommand cmd(path, args);
+        if (!cmd.run(-1))
+            return false;
+
+        const QFileInfo info(path);
+        ToolProbe p;
+        p.path = path;
+        p.args = args;
+        p.modified = info.lastModified().toMSecsSinceEpoch();
+        p.size = info.size();
+        p.exitCode = cmd.exitCode();
+        p.output = cmd.output();
+        it = probes.insert(key, p);
+        dirty = true;
+    }
+
+    exitCode = it->exitCode;
+    output = it->output;
+    return true;
+}
+
+/** Starts queuing probes missing from the cache instead of running them one by one */
+void ExternalToolCache::beginCollecting()
+{
+    QMutexLocker locker(&cacheMutex);
+    collecting = true;
+    collected.clear();
+}
+
+/** Runs all probes queued since beginCollecting() in parallel and stops collecting.
+    @return true if any probes were queued, i.e. their callers have to ask again
+*/
+bool ExternalToolCache::runCollected()
+{
+    QMutexLocker locker(&cacheMutex);
+    collecting = false;
+    if (collected.isEmpty())
+        return false;
+
+    QList<ExternalCommand*> commands;
+    QList<ToolProbe> pending;
+    for (const QStringList& probe : qAsConst(collected)) {
+        const QFileInfo info(resolve(probe.first()));
+
+        ToolProbe p;
+        p.path = info.filePath();
+        p.args = probe.mid(1);
+        p.modified = info.lastModified().toMSecsSinceEpoch();
+        p.size = info.size();
+        pending.append(p);
+        commands.append(new ExternalCommand(p.path, p.args));
+    }
+    collected.clear();
+
+    // Probes that fail here are simply run again one by one on the next request
+    if (ExternalCommand::runBatch(commands)) {
+        for (int i = 0; i < commands.size(); ++i) {
+            if (commands[i]->exitCode() == -1)
+                continue;
+
+            pending[i].exitCode = commands[i]->exitCode();
+            pending[i].output = commands[i]->output();
+            probes.insert(probeKey(pending[i].path, pending[i].args), pending[i]);
+            dirty = true;
+        }
+    }
+
+    qDeleteAll(commands);
+    return true;
+}
+
+/** Writes the probe results to the cache file if anything changed.
+    @return true on success
+*/
+bool ExternalToolCache::save()
+{
+    QMutexLocker locker(&cacheMutex);
+    if (!dirty)
+        return true;
+
+    const QString path = cachePath();
+    QDir().mkpath(QFileInfo(path).path());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream << cacheMagic << cacheVersion << probes;
+    if (stream.status() != QDataStream::Ok || !file.commit())
+        return false;
+
+    dirty = false;
+    return true;
+}
@@ -0,0 +1,43 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#ifndef KPMCORE_EXTERNALTOOLCACHE_H
+#define KPMCORE_EXTERNALTOOLCACHE_H
+
+#include <QString>
+#include <QStringList>
+
+/** Resolves external tools and caches the output of probes run on them.
+
+    Executables are looked up in PATH without running them; the lookup is cached
+    for as long as PATH stays the same. Probes, i.e. commands run once to detect
+    features or versions of a tool, are cached on disk keyed by the executable
+    path and its modification time, so later starts only rerun them after the
+    tool was updated.
+*/
+class ExternalToolCache
+{
+public:
+    static QString resolve(const QString& cmdName);
+    static bool probe(const QString& cmdName, const QStringList& args, int& exitCode, QString& output);
+
+    static void beginCollecting();
+    static bool runCollected();
+    static bool save();
+};
+
+#endif
@@ -19,6 +19,7 @@
 #include "util/helpers.h"
 #include "util/externalcommand.h"
 #include "util/globallog.h"
+#include "util/mountindex.h"
 
 #include "ops/operation.h"
 
@@ -38,17 +39,7 @@ bool caseInsensitiveLessThan(const QString& s1, const QString& s2)
 
 bool isMounted(const QString& deviceNode)
 {
-    ExternalCommand cmd(QStringLiteral("lsblk"),
-                        { QStringLiteral("--noheadings"),
-                          QStringLiteral("--nodeps"),
-                          QStringLiteral("--output"),
-                          QStringLiteral("mountpoint"),
-                          deviceNode });
-
-    if (cmd.run(-1) && cmd.exitCode() == 0) {
-        return !cmd.output().trimmed().isEmpty();
-    }
-    return false;
+    return MountIndex::isMounted(deviceNode);
 }
 
 KAboutData aboutKPMcore()
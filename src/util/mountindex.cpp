@@ -0,0 +1,227 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#include "util/mountindex.h"
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+struct MountIndexEntry
+{
+    QStringList mountPoints; /**< mount points of the whole file system first, then bind mounts of subdirectories */
+    int rootMounts = 0;      /**< number of mount points of the whole file system */
+    bool swap = false;
+};
+
+static QMutex indexMutex;
+static QHash<dev_t, MountIndexEntry> mountIndex;
+static bool indexValid = false;
+
+/** Keeps a file in /proc open to poll it for changes.
+    The kernel flags the file with POLLPRI/POLLERR whenever its contents change.
+*/
+class ProcWatch
+{
+public:
+    explicit ProcWatch(const char* path) : m_Fd(open(path, O_RDONLY | O_CLOEXEC)) {}
+    ~ProcWatch() {
+        if (m_Fd >= 0)
+            close(m_Fd);
+    }
+
+    bool changed() const {
+        if (m_Fd < 0)
+            return true;
+
+        pollfd pfd = { m_Fd, POLLPRI, 0 };
+        return poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLPRI | POLLERR));
+    }
+
+    // Reading the file through the polled descriptor clears the pending event
+    QByteArray readAll() const {
+        QByteArray data;
+        if (m_Fd < 0 || lseek(m_Fd, 0, SEEK_SET) < 0)
+            return data;
+
+        char buffer[16384];
+        ssize_t length;
+        while ((length = read(m_Fd, buffer, sizeof(buffer))) > 0)
+            data.append(buffer, length);
+
+        return data;
+    }
+
+private:
+    int m_Fd;
+};
+
+/** Decodes the octal escapes (e.g. \040 for a space) used in /proc files */
+static QString unescape(const QByteArray& field)
+{
+    QByteArray result;
+    result.reserve(field.size());
+    for (int i = 0; i < field.size(); ++i) {
+        if (field[i] == '\\' && i + 3 < field.size()) {
+            bool ok;
+            const int c = field.mid(i + 1, 3).toInt(&ok, 8);
+            if (ok) {
+                result.append(static_cast<char>(c));
+                i += 3;
+                continue;
+            }
+        }
+        result.append(field[i]);
+    }
+
+    return QString::fromLocal8Bit(result);
+}
+
+static dev_t blockDeviceNumber(const QString& path)
+{
+    struct stat st;
+    if (stat(QFile::encodeName(path).constData(), &st) == 0 && S_ISBLK(st.st_mode))
+        return st.st_rdev;
+
+    return 0;
+}
+
+static void addMountPoint(dev_t number, const QString& mountPoint, bool wholeFileSystem)
+{
+    MountIndexEntry& entry = mountIndex[number];
+    if (entry.mountPoints.contains(mountPoint))
+        return;
+
+    // Keep mounts of the file system root ahead of bind mounts of subdirectories
+    if (wholeFileSystem)
+        entry.mountPoints.insert(entry.rootMounts++, mountPoint);
+    else
+        entry.mountPoints.append(mountPoint);
+}
+
+/* Line format (see proc(5)):
+   36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 - ext3 /dev/root rw,errors=continue
+   The device number in field 3 is anonymous for some file systems (e.g. btrfs),
+   so the mount source is resolved too.
+*/
+static void parseMountInfo(const QByteArray& data)
+{
+    const QList<QByteArray> lines = data.split('\n');
+    for (const QByteArray& line : lines) {
+        const QList<QByteArray> fields = line.split(' ');
+        const int separator = fields.indexOf("-");
+        if (fields.size() < 6 || separator < 6 || separator + 2 >= fields.size())
+            continue;
+
+        const QList<QByteArray> majorMinor = fields[2].split(':');
+        if (majorMinor.size() != 2)
+            continue;
+
+        const bool wholeFileSystem = fields[3] == "/";
+        const QString mountPoint = unescape(fields[4]);
+
+        const dev_t number = makedev(majorMinor[0].toUInt(), majorMinor[1].toUInt());
+        addMountPoint(number, mountPoint, wholeFileSystem);
+
+        const QString source = unescape(fields[separator + 2]);
+        if (source.startsWith(QLatin1Char('/'))) {
+            const dev_t sourceNumber = blockDeviceNumber(source);
+            if (sourceNumber != 0 && sourceNumber != number)
+                addMountPoint(sourceNumber, mountPoint, wholeFileSystem);
+        }
+    }
+}
+
+/* Filename    Type       Size     Used  Priority
+   /dev/sda2   partition  8388604  0     -2
+*/
+static void parseSwaps(const QByteArray& data)
+{
+    const QList<QByteArray> lines = data.split('\n');
+    for (int i = 1; i < lines.size(); ++i) {
+        const QByteArray fileName = lines[i].simplified().split(' ').value(0);
+        if (fileName.isEmpty())
+            continue;
+
+        const dev_t number = blockDeviceNumber(unescape(fileName));
+        if (number != 0)
+            mountIndex[number].swap = true;
+    }
+}
+
+static void updateIndex()
+{
+    static ProcWatch mountInfo("/proc/self/mountinfo");
+    static ProcWatch swaps("/proc/swaps");
+
+    // Evaluate both so that pending events are consumed by the reparse below
+    const bool mountsChanged = mountInfo.changed();
+    const bool swapsChanged = swaps.changed();
+    if (indexValid && !mountsChanged && !swapsChanged)
+        return;
+
+    mountIndex.clear();
+    parseMountInfo(mountInfo.readAll());
+    parseSwaps(swaps.readAll());
+    indexValid = true;
+}
+
+/** Finds all mount points of a block device, including bind mounts.
+    @param deviceNode the device node or a symlink to it (e.g. "/dev/sda1")
+    @return mount points; mounts of the file system root come first
+*/
+QStringList MountIndex::mountPoints(const QString& deviceNode)
+{
+    const dev_t number = blockDeviceNumber(deviceNode);
+    if (number == 0)
+        return QStringList();
+
+    QMutexLocker locker(&indexMutex);
+    updateIndex();
+    return mountIndex.value(number).mountPoints;
+}
+
+/** @param deviceNode the device node or a symlink to it (e.g. "/dev/sda1")
+    @return true if the device is mounted or used as swap
+*/
+bool MountIndex::isMounted(const QString& deviceNode)
+{
+    const dev_t number = blockDeviceNumber(deviceNode);
+    if (number == 0)
+        return false;
+
+    QMutexLocker locker(&indexMutex);
+    updateIndex();
+
+    const auto it = mountIndex.constFind(number);
+    return it != mountIndex.constEnd() && (it->swap || !it->mountPoints.isEmpty());
+}
+
+/** Forces the index to be rebuilt on next access, e.g. before a scan */
+void MountIndex::refresh()
+{
+    QMutexLocker locker(&indexMutex);
+    indexValid = false;
+}
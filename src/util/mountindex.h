@@ -0,0 +1,38 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+#ifndef KPMCORE_MOUNTINDEX_H
+#define KPMCORE_MOUNTINDEX_H
+
+#include <QString>
+#include <QStringList>
+
+/** Index of mounted block devices.
+
+    /proc/self/mountinfo and /proc/swaps are parsed once into an index keyed by device
+    number. Both files are polled for changes and only reparsed after the kernel
+    reports that the mount table or the list of active swap areas changed.
+*/
+class MountIndex
+{
+public:
+    static QStringList mountPoints(const QString& deviceNode);
+    static bool isMounted(const QString& deviceNode);
+    static void refresh();
+};
+
+#endif
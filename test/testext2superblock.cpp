@@ -0,0 +1,104 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+//  SPDX-License-Identifier: GPL-3.0+
+
+// Compares the in-process ext superblock reader with dumpe2fs -h and times
+// both on 50 ext4 images.
+
+#include "helpers.h"
+
+#include "fs/ext2.h"
+#include "util/externalcommand.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QTemporaryDir>
+
+static const qint64 imageSize = 8 * 1024 * 1024;
+static const int images = 50;
+
+static bool createImage(const QString& path, const QString& label)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || !file.resize(imageSize))
+        return false;
+    file.close();
+
+    ExternalCommand mkfs(QStringLiteral("mkfs.ext4"), { QStringLiteral("-qF"), QStringLiteral("-L"), label, path });
+    return mkfs.run(-1) && mkfs.exitCode() == 0;
+}
+
+static qint64 dumpe2fsValue(const QString& output, const QString& field)
+{
+    const QRegularExpressionMatch match = QRegularExpression(field + QStringLiteral(":\\s+(\\d+)")).match(output);
+    return match.hasMatch() ? match.captured(1).toLongLong() : -1;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    KPMCoreInitializer i(argc == 2 ? QString::fromLocal8Bit(argv[1]) : QStringLiteral("pmsfdiskbackendplugin"));
+    if (!i.isValid())
+        return EXIT_FAILURE;
+
+    QTemporaryDir dir;
+    QStringList paths;
+    for (int n = 0; n < images; ++n) {
+        paths.append(dir.filePath(QStringLiteral("ext4-%1.img").arg(n)));
+        if (!createImage(paths.last(), QStringLiteral("label%1").arg(n)))
+            return EXIT_FAILURE;
+    }
+
+    QList<FS::ext2::Superblock> native;
+    QElapsedTimer timer;
+    timer.start();
+    for (const QString& path : qAsConst(paths)) {
+        FS::ext2::Superblock superblock;
+        if (!FS::ext2::readSuperblock(path, superblock))
+            return EXIT_FAILURE;
+        native.append(superblock);
+    }
+    const qint64 nativeTime = timer.elapsed();
+
+    QStringList dumpe2fs;
+    timer.restart();
+    for (const QString& path : qAsConst(paths)) {
+        ExternalCommand cmd(QStringLiteral("dumpe2fs"), { QStringLiteral("-h"), path });
+        if (!cmd.run(-1) || cmd.exitCode() != 0)
+            return EXIT_FAILURE;
+        dumpe2fs.append(cmd.output());
+    }
+    const qint64 dumpe2fsTime = timer.elapsed();
+
+    qDebug() << images << "ext4 images" << "native:" << nativeTime << "ms" << "dumpe2fs:" << dumpe2fsTime << "ms";
+
+    for (int n = 0; n < images; ++n) {
+        const qint64 used = (dumpe2fsValue(dumpe2fs[n], QStringLiteral("Block count")) - dumpe2fsValue(dumpe2fs[n], QStringLiteral("Free blocks")))
+                            * dumpe2fsValue(dumpe2fs[n], QStringLiteral("Block size"));
+        if (used != (native[n].blockCount - native[n].freeBlocks) * native[n].blockSize ||
+            native[n].label != QStringLiteral("label%1").arg(n) ||
+            !dumpe2fs[n].contains(native[n].uuid))
+            return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
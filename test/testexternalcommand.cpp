@@ -51,6 +51,22 @@ class runcmd2 : public QThread
     }
 };
 
+class runcmdasync : public QThread
+{
+    public:
+    void run() override
+    {
+        // Issue several commands at once and only then wait for their results
+        QList<QFuture<QVariantMap>> futures;
+        for (const QString& column : { QStringLiteral("name"), QStringLiteral("size"), QStringLiteral("model") }) {
+            ExternalCommand lsblkCmd(QStringLiteral("lsblk"), { QStringLiteral("--nodeps"), QStringLiteral("--output"), column });
+            futures.append(lsblkCmd.startAsync());
+        }
+
+        for (auto& future : futures)
+            qDebug().noquote() << QString::fromLocal8Bit(future.result()[QStringLiteral("output")].toByteArray());
+    }
+};
 
 int main( int argc, char **argv )
 {
@@ -59,6 +75,7 @@ int main( int argc, char **argv )
 
     runcmd a;
     runcmd2 b;
+    runcmdasync c;
 
     a.start();
     a.wait();
@@ -66,5 +83,8 @@ int main( int argc, char **argv )
     b.start();
     b.wait();
 
+    c.start();
+    c.wait();
+
     return 0;
 }
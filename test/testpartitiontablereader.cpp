@@ -0,0 +1,256 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+//  SPDX-License-Identifier: GPL-3.0+
+
+// Compares the in-process GPT/MBR reader with sfdisk --json and times both
+// on a GPT image with 128 entries and on an MBR image with a long chain of
+// logical partitions. An unpartitioned FAT image must not yield partitions.
+
+#include "helpers.h"
+
+#include "core/diskdevice.h"
+#include "plugins/sfdisk/sfdisktablereader.h"
+#include "util/externalcommand.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QtEndian>
+
+static const qint64 sectorSize = 512;
+static const qint64 totalSectors = 1024 * 1024;
+static const int iterations = 10;
+
+static void put16(QByteArray& data, int offset, quint16 value)
+{
+    qToLittleEndian<quint16>(value, reinterpret_cast<uchar*>(data.data() + offset));
+}
+
+static void put32(QByteArray& data, int offset, quint32 value)
+{
+    qToLittleEndian<quint32>(value, reinterpret_cast<uchar*>(data.data() + offset));
+}
+
+static void put64(QByteArray& data, int offset, quint64 value)
+{
+    qToLittleEndian<quint64>(value, reinterpret_cast<uchar*>(data.data() + offset));
+}
+
+static bool writeAt(QFile& file, qint64 sector, const QByteArray& data)
+{
+    return file.seek(sector * sectorSize) && file.write(data) == data.size();
+}
+
+static QByteArray mbrSector()
+{
+    QByteArray mbr(sectorSize, 0);
+    mbr[510] = 0x55;
+    mbr[511] = static_cast<char>(0xaa);
+    return mbr;
+}
+
+static QByteArray gptHeader(qint64 myLba, qint64 alternateLba, qint64 entriesLba, quint32 entriesCrc)
+{
+    QByteArray header(sectorSize, 0);
+    header.replace(0, 8, QByteArrayLiteral("EFI PART"));
+    put32(header, 8, 0x00010000);
+    put32(header, 12, 92);
+    put64(header, 24, myLba);
+    put64(header, 32, alternateLba);
+    put64(header, 40, 34);
+    put64(header, 48, totalSectors - 34);
+    for (int i = 0; i < 16; ++i)
+        header[56 + i] = static_cast<char>(0x10 + i);
+    put64(header, 72, entriesLba);
+    put32(header, 80, 128);
+    put32(header, 84, 128);
+    put32(header, 88, entriesCrc);
+    put32(header, 16, SfdiskTableReader::crc32(header.constData(), 92));
+    return header;
+}
+
+static bool createGptImage(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || !file.resize(totalSectors * sectorSize))
+        return false;
+
+    // Linux filesystem data partitions filling all 128 entries
+    const QByteArray linuxType = QByteArray::fromHex("AF3DC60F838472478E793D69D8477DE4");
+    QByteArray entries(128 * 128, 0);
+    for (int i = 0; i < 128; ++i) {
+        entries.replace(i * 128, 16, linuxType);
+        for (int j = 0; j < 16; ++j)
+            entries[i * 128 + 16 + j] = static_cast<char>(i + j);
+        put64(entries, i * 128 + 32, 2048 + i * 4096);
+        put64(entries, i * 128 + 40, 2048 + i * 4096 + 4095);
+        entries[i * 128 + 56] = 'p';
+    }
+    const quint32 entriesCrc = SfdiskTableReader::crc32(entries.constData(), entries.size());
+
+    QByteArray mbr = mbrSector();
+    mbr[446 + 4] = static_cast<char>(0xee);
+    put32(mbr, 446 + 8, 1);
+    put32(mbr, 446 + 12, totalSectors - 1);
+
+    return writeAt(file, 0, mbr) &&
+           writeAt(file, 1, gptHeader(1, totalSectors - 1, 2, entriesCrc)) &&
+           writeAt(file, 2, entries) &&
+           writeAt(file, totalSectors - 33, entries) &&
+           writeAt(file, totalSectors - 1, gptHeader(totalSectors - 1, 1, totalSectors - 33, entriesCrc));
+}
+
+static bool createMbrImage(const QString& path, int logicalPartitions)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || !file.resize(totalSectors * sectorSize))
+        return false;
+
+    const qint64 extendedStart = 2048;
+    QByteArray mbr = mbrSector();
+    mbr[446 + 4] = 0x05;
+    put32(mbr, 446 + 8, extendedStart);
+    put32(mbr, 446 + 12, totalSectors - extendedStart);
+    if (!writeAt(file, 0, mbr))
+        return false;
+
+    for (int i = 0; i < logicalPartitions; ++i) {
+        const qint64 ebrLba = extendedStart + i * 4096;
+        QByteArray ebr = mbrSector();
+        ebr[446 + 4] = static_cast<char>(0x83);
+        put32(ebr, 446 + 8, 2048);
+        put32(ebr, 446 + 12, 2048);
+        if (i + 1 < logicalPartitions) {
+            ebr[462 + 4] = 0x05;
+            put32(ebr, 462 + 8, (i + 1) * 4096);
+            put32(ebr, 462 + 12, 4096);
+        }
+        if (!writeAt(file, ebrLba, ebr))
+            return false;
+    }
+
+    return true;
+}
+
+/** An unpartitioned FAT16 stick: the boot code fills the partition table area of sector 0 */
+static bool createFatImage(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || !file.resize(totalSectors * sectorSize))
+        return false;
+
+    QByteArray vbr = mbrSector();
+    vbr[0] = static_cast<char>(0xeb);
+    vbr[1] = 0x3c;
+    vbr[2] = static_cast<char>(0x90);
+    vbr.replace(3, 8, QByteArrayLiteral("MSDOS5.0"));
+    put16(vbr, 11, sectorSize);
+    vbr[13] = 16;
+    put16(vbr, 14, 4);
+    vbr[16] = 2;
+    put16(vbr, 17, 512);
+    vbr[21] = static_cast<char>(0xf8);
+    put16(vbr, 22, 256);
+    put32(vbr, 32, totalSectors);
+    vbr[38] = 0x29;
+    vbr.replace(54, 8, QByteArrayLiteral("FAT16   "));
+    for (int i = 62; i < 510; ++i)
+        vbr[i] = static_cast<char>(i * 37);
+
+    // Boot code that happens to look like a valid partition entry
+    vbr.replace(446, 64, QByteArray(64, 0));
+    vbr[446 + 4] = static_cast<char>(0x83);
+    put32(vbr, 446 + 8, 2048);
+    put32(vbr, 446 + 12, 4096);
+
+    return writeAt(file, 0, vbr);
+}
+
+static bool samePartitions(const QJsonObject& native, const QJsonObject& sfdisk)
+{
+    const QJsonArray a = native[QLatin1String("partitions")].toArray();
+    const QJsonArray b = sfdisk[QLatin1String("partitions")].toArray();
+    if (a.size() != b.size() || native[QLatin1String("label")] != sfdisk[QLatin1String("label")])
+        return false;
+
+    for (int i = 0; i < a.size(); ++i) {
+        const QJsonObject p = a[i].toObject();
+        const QJsonObject q = b[i].toObject();
+        if (p[QLatin1String("start")].toVariant().toLongLong() != q[QLatin1String("start")].toVariant().toLongLong() ||
+            p[QLatin1String("size")].toVariant().toLongLong() != q[QLatin1String("size")].toVariant().toLongLong() ||
+            p[QLatin1String("type")].toString().compare(q[QLatin1String("type")].toString(), Qt::CaseInsensitive) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+static bool compare(const QString& path)
+{
+    DiskDevice device(path, path, 255, 63, totalSectors / 255 / 63, sectorSize);
+
+    QJsonObject native;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        SfdiskTableReader reader(device);
+        native = reader.read();
+    }
+    const qint64 nativeTime = timer.elapsed();
+
+    QJsonObject sfdisk;
+    timer.restart();
+    for (int i = 0; i < iterations; ++i) {
+        ExternalCommand jsonCommand(QStringLiteral("sfdisk"), { QStringLiteral("--json"), path }, QProcess::ProcessChannelMode::SeparateChannels);
+        if (jsonCommand.run(-1) && jsonCommand.exitCode() == 0)
+            sfdisk = QJsonDocument::fromJson(jsonCommand.rawOutput()).object()[QLatin1String("partitiontable")].toObject();
+    }
+    const qint64 sfdiskTime = timer.elapsed();
+
+    qDebug() << path << "partitions:" << native[QLatin1String("partitions")].toArray().size()
+             << "native:" << nativeTime / iterations << "ms" << "sfdisk:" << sfdiskTime / iterations << "ms";
+
+    return samePartitions(native, sfdisk);
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    KPMCoreInitializer i(argc == 2 ? QString::fromLocal8Bit(argv[1]) : QStringLiteral("pmsfdiskbackendplugin"));
+    if (!i.isValid())
+        return EXIT_FAILURE;
+
+    QTemporaryDir dir;
+    const QString gptImage = dir.filePath(QStringLiteral("gpt.img"));
+    const QString mbrImage = dir.filePath(QStringLiteral("mbr.img"));
+    const QString fatImage = dir.filePath(QStringLiteral("fat.img"));
+    if (!createGptImage(gptImage) || !createMbrImage(mbrImage, 200) || !createFatImage(fatImage))
+        return EXIT_FAILURE;
+
+    // A volume boot record must not be decoded as a partition table
+    DiskDevice fatDevice(fatImage, fatImage, 255, 63, totalSectors / 255 / 63, sectorSize);
+    if (!SfdiskTableReader(fatDevice).read().isEmpty())
+        return EXIT_FAILURE;
+
+    return compare(gptImage) && compare(mbrImage) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,110 @@
+/*************************************************************************
+ *  Copyright (C) 2026 by agent <agent@local>                            *
+ *                                                                       *
+ *  This program is free software; you can redistribute it and/or        *
+ *  modify it under the terms of the GNU General Public License as       *
+ *  published by the Free Software Foundation; either version 3 of       *
+ *  the License, or (at your option) any later version.                  *
+ *                                                                       *
+ *  This program is distributed in the hope that it will be useful,      *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ *  GNU General Public License for more details.                         *
+ *                                                                       *
+ *  You should have received a copy of the GNU General Public License    *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ *************************************************************************/
+
+//  SPDX-License-Identifier: GPL-3.0+
+
+// Times parsing of smartctl JSON output of a disk with 30 attributes and
+// checks that quirks are applied to its attributes.
+
+#include "core/smartattributeparseddata.h"
+#include "core/smartdiskinformation.h"
+#include "core/smartparser.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+static const int disks = 1000;
+static const int attributeIds[] = { 1, 2, 3, 4, 5, 7, 8, 9, 10, 12, 13, 183, 184, 187, 188,
+                                    189, 190, 191, 192, 193, 194, 195, 196, 197, 198, 199, 200, 240, 241, 242 };
+
+static QJsonDocument smartOutput(const QString& model, const QString& firmware)
+{
+    QJsonArray table;
+    for (int id : attributeIds) {
+        const qint64 raw = id == 194 || id == 190 ? 35 : id;
+        table.append(QJsonObject {
+            { QStringLiteral("id"), id },
+            { QStringLiteral("value"), 100 },
+            { QStringLiteral("worst"), 100 },
+            { QStringLiteral("thresh"), 10 },
+            { QStringLiteral("raw"), QJsonObject { { QStringLiteral("value"), raw } } },
+            { QStringLiteral("flags"), QJsonObject { { QStringLiteral("prefailure"), id == 5 },
+                                                     { QStringLiteral("updated_online"), true } } }
+        });
+    }
+
+    return QJsonDocument(QJsonObject {
+        { QStringLiteral("device"), QJsonObject { { QStringLiteral("name"), QStringLiteral("/dev/sda") } } },
+        { QStringLiteral("model_name"), model },
+        { QStringLiteral("firmware_version"), firmware },
+        { QStringLiteral("serial_number"), QStringLiteral("S0000000") },
+        { QStringLiteral("smart_status"), QJsonObject { { QStringLiteral("passed"), true } } },
+        { QStringLiteral("user_capacity"), QJsonObject { { QStringLiteral("bytes"), 500107862016LL } } },
+        { QStringLiteral("self_test"), QJsonObject { { QStringLiteral("status"), QJsonObject { { QStringLiteral("value"), 0 } } } } },
+        { QStringLiteral("ata_smart_attributes"), QJsonObject { { QStringLiteral("table"), table } } }
+    });
+}
+
+static bool parse(const QJsonDocument& output, SmartQuirk expected)
+{
+    SmartParser parser(QStringLiteral("/dev/sda"), output);
+    if (!parser.init())
+        return false;
+
+    const SmartDiskInformation *disk = parser.diskInformation();
+    const QList<SmartAttributeParsedData> attributes = disk->attributes();
+    if (disk->quirks() != expected || attributes.size() != static_cast<int>(sizeof(attributeIds) / sizeof(attributeIds[0])))
+        return false;
+
+    for (const SmartAttributeParsedData &attribute : attributes)
+        if (attribute.disk() != disk)
+            return false;
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    const QJsonDocument plain = smartOutput(QStringLiteral("WDC WD5000AAKX-00ERMA0"), QStringLiteral("15.01H15"));
+    const QJsonDocument quirky = smartOutput(QStringLiteral("FUJITSU MHY2120BH"), QStringLiteral("0085000B"));
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!parse(quirky, static_cast<SmartQuirk>(SmartQuirk::SMART_QUIRK_9_POWERONMINUTES |
+                                                 SmartQuirk::SMART_QUIRK_197_UNKNOWN |
+                                                 SmartQuirk::SMART_QUIRK_198_UNKNOWN)))
+        return EXIT_FAILURE;
+    const qint64 firstTime = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int n = 0; n < disks; ++n)
+        if (!parse(plain, SmartQuirk::None))
+            return EXIT_FAILURE;
+    const qint64 parseTime = timer.nsecsElapsed();
+
+    qDebug() << "first disk:" << firstTime / 1000 << "us"
+             << disks << "disks with 30 attributes:" << parseTime / 1000000 << "ms"
+             << "(" << parseTime / disks / 1000 << "us per disk )";
+
+    return EXIT_SUCCESS;
+}